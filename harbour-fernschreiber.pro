@@ -19,13 +19,22 @@ PKGCONFIG += nemonotifications-qt5 ngf-qt5
 QT += core dbus
 
 SOURCES += src/harbour-fernschreiber.cpp \
+    src/chatlistfiltermodel.cpp \
     src/chatlistmodel.cpp \
     src/chatmodel.cpp \
+    src/chatsearchindex.cpp \
     src/dbusadaptor.cpp \
     src/dbusinterface.cpp \
+    src/emojiengine.cpp \
+    src/emojiimageprovider.cpp \
+    src/mediapreprocessor.cpp \
+    src/messageformatter.cpp \
+    src/messageoutbox.cpp \
     src/notificationmanager.cpp \
+    src/relativetimeclock.cpp \
     src/tdlibreceiver.cpp \
-    src/tdlibwrapper.cpp
+    src/tdlibwrapper.cpp \
+    src/unreadaggregator.cpp
 
 DISTFILES += qml/harbour-fernschreiber.qml \
     qml/components/AudioPreview.qml \
@@ -90,11 +99,20 @@ INSTALLS += telegram 86.png 108.png 128.png 172.png 256.png \
             fernschreiber.desktop gui images
 
 HEADERS += \
+    src/chatlistfiltermodel.h \
     src/chatlistmodel.h \
     src/chatmodel.h \
+    src/chatsearchindex.h \
     src/dbusadaptor.h \
     src/dbusinterface.h \
+    src/emojiengine.h \
+    src/emojiimageprovider.h \
+    src/mediapreprocessor.h \
+    src/messageformatter.h \
+    src/messageoutbox.h \
     src/notificationmanager.h \
+    src/relativetimeclock.h \
     src/tdlibreceiver.h \
     src/tdlibsecrets.h \
-    src/tdlibwrapper.h
+    src/tdlibwrapper.h \
+    src/unreadaggregator.h
@@ -25,6 +25,7 @@ Item {
     id: audioMessageComponent
 
     property variant audioData;
+    property variant waveform;
     property string audioUrl;
     property int previewFileId;
     property int audioFileId;
@@ -127,6 +128,31 @@ Item {
         opacity: 0.15
     }
 
+    Row {
+        id: waveformRow
+        width: parent.width - ( 2 * Theme.paddingLarge )
+        height: parent.height / 3
+        anchors {
+            horizontalCenter: parent.horizontalCenter
+            bottom: parent.bottom
+            bottomMargin: Theme.paddingLarge
+        }
+        spacing: waveform && waveform.length > 0 ? Math.min(Theme.paddingSmall, width / waveform.length / 3) : 0
+        visible: waveform && waveform.length > 0 ? true : false
+
+        Repeater {
+            model: waveform
+            delegate: Rectangle {
+                // Values range from 0 to 31
+                width: ( waveformRow.width - ( waveformRow.spacing * ( waveform.length - 1 ) ) ) / waveform.length
+                height: Math.max(1, waveformRow.height * modelData / 31)
+                anchors.bottom: parent.bottom
+                color: Theme.highlightColor
+                opacity: 0.6
+            }
+        }
+    }
+
     Rectangle {
         id: placeholderBackground
         color: "black"
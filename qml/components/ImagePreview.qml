@@ -26,6 +26,7 @@ Item {
 
     property variant photoData;
     property variant pictureFileInformation;
+    property real uploadProgress: 0
 
     Component.onCompleted: {
         updatePicture();
@@ -53,6 +54,12 @@ Item {
         target: tdLibWrapper
         onFileUpdated: {
             if (imagePreviewItem.pictureFileInformation) {
+                if (fileId === imagePreviewItem.pictureFileInformation.id && fileInformation.remote.is_uploading_active) {
+                    imagePreviewItem.uploadProgress = fileInformation.expected_size > 0 ? fileInformation.remote.uploaded_size / fileInformation.expected_size : 0;
+                }
+                if (fileId === imagePreviewItem.pictureFileInformation.id && fileInformation.remote.is_uploading_completed) {
+                    imagePreviewItem.uploadProgress = 0;
+                }
                 if (fileId === imagePreviewItem.pictureFileInformation.id && fileInformation.local.is_downloading_completed) {
                     imagePreviewItem.pictureFileInformation = fileInformation;
                     singleImage.source = fileInformation.local.path;
@@ -96,4 +103,16 @@ Item {
         opacity: 0.15
     }
 
+    Rectangle {
+        id: uploadProgressBar
+        anchors {
+            left: singleImage.left
+            bottom: singleImage.bottom
+        }
+        width: singleImage.width * imagePreviewItem.uploadProgress
+        height: Theme.paddingSmall
+        color: Theme.highlightColor
+        visible: imagePreviewItem.uploadProgress > 0
+    }
+
 }
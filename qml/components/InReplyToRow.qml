@@ -21,7 +21,6 @@ import Sailfish.Silica 1.0
 import QtMultimedia 5.0
 import "../components"
 import "../js/functions.js" as Functions
-import "../js/twemoji.js" as Emoji
 
 Row {
     id: inReplyToRow
@@ -30,11 +29,19 @@ Row {
 
     property string myUserId;
     property variant inReplyToMessage;
+    property variant replyPreview;
 
     onInReplyToMessageChanged: {
         if (inReplyToMessage) {
-            inReplyToUserText.text = (inReplyToRow.inReplyToMessage.sender_user_id !== inReplyToRow.myUserId) ? Emoji.emojify(Functions.getUserName(tdLibWrapper.getUserInformation(inReplyToRow.inReplyToMessage.sender_user_id)), inReplyToUserText.font.pixelSize) : qsTr("You");
-            inReplyToMessageText.text = Emoji.emojify(Functions.getMessageText(inReplyToRow.inReplyToMessage, true), inReplyToMessageText.font.pixelSize);
+            inReplyToUserText.text = (inReplyToRow.inReplyToMessage.sender_user_id !== inReplyToRow.myUserId) ? emojiEngine.emojify(Functions.getUserName(tdLibWrapper.getUserInformation(inReplyToRow.inReplyToMessage.sender_user_id)), inReplyToUserText.font.pixelSize) : qsTr("You");
+            inReplyToMessageText.text = emojiEngine.emojify(Functions.getMessageText(inReplyToRow.inReplyToMessage, true), inReplyToMessageText.font.pixelSize);
+        }
+    }
+
+    onReplyPreviewChanged: {
+        if (replyPreview && typeof replyPreview.text !== "undefined") {
+            inReplyToUserText.text = replyPreview.sender;
+            inReplyToMessageText.text = replyPreview.text;
         }
     }
 
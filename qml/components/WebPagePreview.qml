@@ -20,7 +20,6 @@ import QtQuick 2.5
 import QtGraphicalEffects 1.0
 import Sailfish.Silica 1.0
 import "../components"
-import "../js/twemoji.js" as Emoji
 import "../js/functions.js" as Functions
 
 Column {
@@ -73,7 +72,7 @@ Column {
         id: siteNameText
 
         width: parent.width
-        text: webPageData.site_name ? Emoji.emojify(webPageData.site_name, font.pixelSize) : ""
+        text: webPageData.site_name ? emojiEngine.emojify(webPageData.site_name, font.pixelSize) : ""
         font.pixelSize: Theme.fontSizeExtraSmall
         font.bold: true
         color: Theme.secondaryHighlightColor
@@ -87,7 +86,7 @@ Column {
         id: titleText
 
         width: parent.width
-        text: webPageData.title ? Emoji.emojify(webPageData.title, font.pixelSize) : ""
+        text: webPageData.title ? emojiEngine.emojify(webPageData.title, font.pixelSize) : ""
         font.pixelSize: Theme.fontSizeExtraSmall
         font.bold: true
         color: Theme.primaryColor
@@ -102,7 +101,7 @@ Column {
         id: descriptionText
 
         width: parent.width
-        text: webPageData.description ? Emoji.emojify(webPageData.description, font.pixelSize) : ""
+        text: webPageData.description ? emojiEngine.emojify(webPageData.description, font.pixelSize) : ""
         font.pixelSize: Theme.fontSizeExtraSmall
         color: Theme.primaryColor
         elide: Text.ElideRight
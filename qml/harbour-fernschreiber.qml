@@ -28,6 +28,10 @@ ApplicationWindow
     cover: Qt.resolvedUrl("pages/CoverPage.qml")
     allowedOrientations: defaultAllowedOrientations
 
+    Component.onCompleted: {
+        emojiEngine.setFontSizes(Theme.fontSizeExtraSmall, Theme.fontSizeSmall, Theme.fontSizeMedium);
+    }
+
     Connections {
         target: dBusAdaptor
         onPleaseOpenMessage: {
@@ -19,7 +19,6 @@
 import QtQuick 2.0
 import Sailfish.Silica 1.0
 import "../components"
-import "../js/twemoji.js" as Emoji
 import "../js/functions.js" as Functions
 
 Page {
@@ -152,7 +151,7 @@ Page {
                 x: Theme.horizontalPageMargin
                 width: parent.width  - ( 2 * Theme.horizontalPageMargin )
                 horizontalAlignment: Text.AlignHCenter
-                text: qsTr("Logged in as %1").arg(Emoji.emojify(aboutPage.userInformation.first_name + " " + aboutPage.userInformation.last_name, Theme.fontSizeSmall))
+                text: qsTr("Logged in as %1").arg(emojiEngine.emojify(aboutPage.userInformation.first_name + " " + aboutPage.userInformation.last_name, Theme.fontSizeSmall))
                 font.pixelSize: Theme.fontSizeSmall
                 wrapMode: Text.Wrap
                 color: Theme.primaryColor
@@ -20,9 +20,9 @@ import QtQuick 2.5
 import QtGraphicalEffects 1.0
 import QtMultimedia 5.0
 import Sailfish.Silica 1.0
+import Sailfish.Pickers 1.0
 import WerkWolf.Fernschreiber 1.0
 import "../components"
-import "../js/twemoji.js" as Emoji
 import "../js/functions.js" as Functions
 
 Page {
@@ -33,6 +33,7 @@ Page {
     property bool isInitialized: false;
     property int myUserId: tdLibWrapper.getUserInformation().id;
     property variant chatInformation;
+    property string anchorMessageId: "";
     property bool isPrivateChat: false;
     property bool isBasicGroup: false;
     property bool isSuperGroup: false;
@@ -87,7 +88,6 @@ Page {
     function initializePage() {
         console.log("[ChatPage] Initializing chat page...");
         chatView.currentIndex = -1;
-        chatView.lastReadSentIndex = 0;
         var chatType = chatInformation.type['@type'];
         isPrivateChat = ( chatType === "chatTypePrivate" );
         isBasicGroup = ( chatType === "chatTypeBasicGroup" );
@@ -105,35 +105,34 @@ Page {
             isChannel = chatGroupInformation.is_channel;
             updateGroupStatusText();
         }
+        if (chatInformation.draft_message && chatInformation.draft_message.input_message_text) {
+            newMessageTextField.text = chatInformation.draft_message.input_message_text.text.text;
+        }
     }
 
-    function getMessageStatusText(message, listItemIndex, lastReadSentIndex) {
+    function getMessageStatusText(edited, elapsedText, sendState) {
         var messageStatusSuffix = "";
 
-        if (message.edit_date > 0) {
+        if (edited) {
             messageStatusSuffix += " - " + qsTr("edited");
         }
 
-        if (chatPage.myUserId === message.sender_user_id) {
+        if (sendState !== "") {
             messageStatusSuffix += "&nbsp;&nbsp;"
-            if (listItemIndex <= lastReadSentIndex) {
+            if (sendState === "read") {
                 // Read by other party
-                messageStatusSuffix += Emoji.emojify("✅", Theme.fontSizeTiny);
+                messageStatusSuffix += emojiEngine.emojify("✅", Theme.fontSizeTiny);
+            } else if (sendState === "pending") {
+                messageStatusSuffix += emojiEngine.emojify("🕙", Theme.fontSizeTiny);
+            } else if (sendState === "failed") {
+                // Sending failed...
+                messageStatusSuffix += emojiEngine.emojify("❌", Theme.fontSizeTiny);
             } else {
                 // Not yet read by other party
-                if (message.sending_state) {
-                    if (message.sending_state['@type'] === "messageSendingStatePending") {
-                        messageStatusSuffix += Emoji.emojify("🕙", Theme.fontSizeTiny);
-                    } else {
-                        // Sending failed...
-                        messageStatusSuffix += Emoji.emojify("❌", Theme.fontSizeTiny);
-                    }
-                } else {
-                    messageStatusSuffix += Emoji.emojify("☑️", Theme.fontSizeTiny);
-                }
+                messageStatusSuffix += emojiEngine.emojify("☑️", Theme.fontSizeTiny);
             }
         }
-        return Functions.getDateTimeElapsed(message.date) + messageStatusSuffix;
+        return elapsedText + messageStatusSuffix;
     }
 
     Component.onCompleted: {
@@ -146,12 +145,21 @@ Page {
         }
         if (status === PageStatus.Active) {
             if (!chatPage.isInitialized) {
-                chatModel.initialize(chatInformation);
+                if (chatPage.anchorMessageId !== "") {
+                    chatModel.initialize(chatInformation, chatPage.anchorMessageId);
+                } else {
+                    chatModel.initialize(chatInformation);
+                }
                 chatPage.isInitialized = true;
             }
         }
         if (status === PageStatus.Deactivating) {
+            chatModel.flushViewedMessages();
             tdLibWrapper.closeChat(chatInformation.id);
+            var topItem = chatView.itemAt(chatView.contentX, chatView.contentY + 1);
+            if (topItem) {
+                chatModel.setScrollAnchor(topItem.myMessage.id);
+            }
         }
     }
 
@@ -187,8 +195,7 @@ Page {
     Connections {
         target: chatModel
         onMessagesReceived: {
-            console.log("[ChatPage] Messages received, view has " + chatView.count + " messages, setting view to index " + modelIndex + ", own messages were read before index " + lastReadSentIndex);
-            chatView.lastReadSentIndex = lastReadSentIndex;
+            console.log("[ChatPage] Messages received, view has " + chatView.count + " messages, setting view to index " + modelIndex);
             if (modelIndex === (chatView.count - 1)) {
                 chatView.positionViewAtEnd();
             } else {
@@ -197,7 +204,7 @@ Page {
             chatPage.loading = false;
             if (chatView.height > chatView.contentHeight) {
                 console.log("[ChatPage] Chat content quite small...");
-                tdLibWrapper.viewMessage(chatInformation.id, chatModel.getMessage(chatView.count - 1).id);
+                chatModel.reportVisibleRange(0, chatView.count - 1);
             }
         }
         onNewMessageReceived: {
@@ -209,24 +216,29 @@ Page {
             chatUnreadMessagesCountBackground.visible = ( !chatPage.loading && unreadCount > 0 );
             chatUnreadMessagesCount.text = unreadCount > 99 ? "99+" : unreadCount;
         }
-        onLastReadSentMessageUpdated: {
-            console.log("[ChatPage] Updating last read sent index, new index: " + lastReadSentIndex);
-            chatView.lastReadSentIndex = lastReadSentIndex;
-        }
         onMessagesIncrementalUpdate: {
-            console.log("Incremental update received. View now has " + chatView.count + " messages, view is on index " + modelIndex + ", own messages were read before index " + lastReadSentIndex);
+            console.log("Incremental update received. View now has " + chatView.count + " messages, view is on index " + modelIndex);
             chatView.currentIndex = modelIndex;
-            chatView.lastReadSentIndex = lastReadSentIndex;
         }
     }
 
-    Timer {
-        id: chatContactTimeUpdater
-        interval: 60000
-        running: true
-        repeat: true
-        onTriggered: {
-            updateChatPartnerStatusText();
+    Component {
+        id: imagePickerPage
+        ImagePickerPage {
+            onSelectedContentPropertiesChanged: {
+                tdLibWrapper.sendPhotoMessage(chatInformation.id, selectedContentProperties.filePath, newMessageTextField.text, newMessageColumn.replyToMessageId);
+                newMessageTextField.text = "";
+                newMessageTextField.focus = false;
+            }
+        }
+    }
+
+    Connections {
+        target: relativeTimeClock
+        onMinuteChanged: {
+            if (isPrivateChat) {
+                updateChatPartnerStatusText();
+            }
         }
     }
 
@@ -291,7 +303,7 @@ Page {
                     anchors.bottomMargin: Theme.paddingSmall
                     Text {
                         id: chatNameText
-                        text: chatInformation.title !== "" ? Emoji.emojify(chatInformation.title, font.pixelSize) : qsTr("Unknown")
+                        text: chatInformation.title !== "" ? emojiEngine.emojify(chatInformation.title, font.pixelSize) : qsTr("Unknown")
                         textFormat: Text.StyledText
                         font.pixelSize: Theme.fontSizeLarge
                         font.family: Theme.fontFamilyHeading
@@ -340,16 +352,6 @@ Page {
                     previousHeight = height;
                 }
 
-                Timer {
-                    id: chatViewLoadingTimer
-                    interval: 100
-                    repeat: false
-                    running: false
-                    onTriggered: {
-                        chatPage.loading = false;
-                    }
-                }
-
                 SilicaListView {
                     id: chatView
 
@@ -360,11 +362,9 @@ Page {
 
                     clip: true
 
-                    property int lastReadSentIndex: 0
-
                     function handleScrollPositionChanged() {
                         console.log("Current position: " + chatView.contentY);
-                        tdLibWrapper.viewMessage(chatInformation.id, chatView.itemAt(chatView.contentX, ( chatView.contentY + chatView.height - Theme.horizontalPageMargin )).myMessage.id);
+                        chatModel.reportVisibleRange(chatView.indexAt(chatView.contentX, chatView.contentY), chatView.indexAt(chatView.contentX, ( chatView.contentY + chatView.height - Theme.horizontalPageMargin )));
                     }
 
                     onContentYChanged: {
@@ -373,6 +373,9 @@ Page {
                                 console.log("Trying to get older history items...");
                                 chatModel.triggerLoadMoreHistory();
                             }
+                            if (chatView.indexAt(chatView.contentX, chatView.contentY + chatView.height - 1) > chatView.count - 10) {
+                                chatModel.triggerLoadMoreFuture();
+                            }
                         }
                     }
 
@@ -394,7 +397,6 @@ Page {
                         contentWidth: parent.width
 
                         property variant myMessage: display
-                        property variant userInformation: tdLibWrapper.getUserInformation(display.sender_user_id)
 
                         menu: ContextMenu {
                             MenuItem {
@@ -447,7 +449,7 @@ Page {
 
                             ProfileThumbnail {
                                 id: messagePictureThumbnail
-                                photoData: (typeof messageListItem.userInformation.profile_photo !== "undefined") ? messageListItem.userInformation.profile_photo.small : ""
+                                photoData: sender_photo
                                 replacementStringHint: userText.text
                                 width: visible ? Theme.itemSizeSmall : 0
                                 height: visible ? Theme.itemSizeSmall : 0
@@ -466,9 +468,9 @@ Page {
                                     id: messageBackground
                                     anchors {
                                         left: parent.left
-                                        leftMargin: (chatPage.myUserId === display.sender_user_id) ? 2 * Theme.horizontalPageMargin : 0
+                                        leftMargin: is_own ? 2 * Theme.horizontalPageMargin : 0
                                         right: parent.right
-                                        rightMargin: (chatPage.myUserId === display.sender_user_id) ? 0 : 2 * Theme.horizontalPageMargin
+                                        rightMargin: is_own ? 0 : 2 * Theme.horizontalPageMargin
                                         verticalCenter: parent.verticalCenter
                                     }
                                     height: messageTextColumn.height + ( 2 * Theme.paddingMedium )
@@ -486,56 +488,41 @@ Page {
                                     width: messageBackground.width - Theme.horizontalPageMargin
                                     anchors.centerIn: messageBackground
 
-                                    Component.onCompleted: {
-                                        if (display.reply_to_message_id !== 0) {
-                                            tdLibWrapper.getMessage(chatInformation.id, display.reply_to_message_id);
-                                        }
-                                    }
-
-                                    Connections {
-                                        target: tdLibWrapper
-                                        onReceivedMessage: {
-                                            if (messageId === display.reply_to_message_id.toString()) {
-                                                messageInReplyToRow.inReplyToMessage = message;
-                                                messageInReplyToRow.visible = true;
-                                            }
-                                        }
-                                    }
-
                                     Text {
                                         id: userText
 
                                         width: parent.width
-                                        text: display.sender_user_id !== chatPage.myUserId ? Emoji.emojify(Functions.getUserName(messageListItem.userInformation), font.pixelSize) : qsTr("You")
+                                        text: sender_name
                                         font.pixelSize: Theme.fontSizeExtraSmall
                                         font.weight: Font.ExtraBold
-                                        color: (chatPage.myUserId === display.sender_user_id) ? Theme.highlightColor : Theme.primaryColor
+                                        color: is_own ? Theme.highlightColor : Theme.primaryColor
                                         maximumLineCount: 1
                                         elide: Text.ElideRight
                                         textFormat: Text.StyledText
-                                        horizontalAlignment: (chatPage.myUserId === display.sender_user_id) ? Text.AlignRight : Text.AlignLeft
+                                        horizontalAlignment: is_own ? Text.AlignRight : Text.AlignLeft
                                         visible: ( chatPage.isBasicGroup || chatPage.isSuperGroup ) && !chatPage.isChannel
                                     }
 
                                     InReplyToRow {
                                         id: messageInReplyToRow
                                         myUserId: chatPage.myUserId
-                                        visible: false
+                                        replyPreview: reply_preview
+                                        visible: typeof reply_preview.text !== "undefined"
                                     }
 
                                     Text {
                                         id: messageText
 
                                         width: parent.width
-                                        text: Emoji.emojify(Functions.getMessageText(display, false), font.pixelSize)
+                                        text: message_text
                                         font.pixelSize: Theme.fontSizeSmall
-                                        color: (chatPage.myUserId === display.sender_user_id) ? Theme.highlightColor : Theme.primaryColor
+                                        color: is_own ? Theme.highlightColor : Theme.primaryColor
                                         wrapMode: Text.Wrap
                                         textFormat: Text.StyledText
                                         onLinkActivated: {
                                             Functions.handleLink(link);
                                         }
-                                        horizontalAlignment: (chatPage.myUserId === display.sender_user_id) ? Text.AlignRight : Text.AlignLeft
+                                        horizontalAlignment: is_own ? Text.AlignRight : Text.AlignLeft
                                         linkColor: Theme.highlightColor
                                         visible: (text !== "")
                                     }
@@ -549,66 +536,42 @@ Page {
 
                                     ImagePreview {
                                         id: messageImagePreview
-                                        photoData: ( display.content['@type'] === "messagePhoto" ) ?  display.content.photo : ""
+                                        photoData: ( content_type === "messagePhoto" ) ?  display.content.photo : ""
                                         width: parent.width
                                         height: parent.width * 2 / 3
-                                        visible: display.content['@type'] === "messagePhoto"
+                                        visible: content_type === "messagePhoto"
                                     }
 
                                     StickerPreview {
                                         id: messageStickerPreview
-                                        stickerData: ( display.content['@type'] === "messageSticker" ) ?  display.content.sticker : ""
-                                        visible: display.content['@type'] === "messageSticker"
+                                        stickerData: ( content_type === "messageSticker" ) ?  display.content.sticker : ""
+                                        visible: content_type === "messageSticker"
                                         anchors.horizontalCenter: parent.horizontalCenter
                                     }
 
                                     VideoPreview {
                                         id: messageVideoPreview
-                                        videoData: ( display.content['@type'] === "messageVideo" ) ?  display.content.video : ( ( display.content['@type'] === "messageAnimation" ) ? display.content.animation : "")
+                                        videoData: ( content_type === "messageVideo" ) ?  display.content.video : ( ( content_type === "messageAnimation" ) ? display.content.animation : "")
                                         width: parent.width
-                                        height: ( display.content['@type'] === "messageVideo" ) ? Functions.getVideoHeight(width, display.content.video) : Functions.getVideoHeight(width, display.content.animation)
-                                        visible: ( display.content['@type'] === "messageVideo" || display.content['@type'] === "messageAnimation" )
+                                        height: ( content_type === "messageVideo" ) ? Functions.getVideoHeight(width, display.content.video) : Functions.getVideoHeight(width, display.content.animation)
+                                        visible: ( content_type === "messageVideo" || content_type === "messageAnimation" )
                                         onScreen: chatPage.status === PageStatus.Active
                                     }
 
                                     AudioPreview {
                                         id: messageAudioPreview
-                                        audioData: ( display.content['@type'] === "messageVoiceNote" ) ?  display.content.voice_note : ( ( display.content['@type'] === "messageAudio" ) ? display.content.audio : "")
+                                        audioData: ( content_type === "messageVoiceNote" ) ?  display.content.voice_note : ( ( content_type === "messageAudio" ) ? display.content.audio : "")
+                                        waveform: voice_waveform
                                         width: parent.width
                                         height: parent.width / 2
-                                        visible: ( display.content['@type'] === "messageVoiceNote" || display.content['@type'] === "messageAudio" )
+                                        visible: ( content_type === "messageVoiceNote" || content_type === "messageAudio" )
                                         onScreen: chatPage.status === PageStatus.Active
                                     }
 
                                     DocumentPreview {
                                         id: messageDocumentPreview
-                                        documentData: ( display.content['@type'] === "messageDocument" ) ?  display.content.document : ""
-                                        visible: display.content['@type'] === "messageDocument"
-                                    }
-
-                                    Timer {
-                                        id: messageDateUpdater
-                                        interval: 60000
-                                        running: true
-                                        repeat: true
-                                        onTriggered: {
-                                            messageDateText.text = getMessageStatusText(display, index, chatView.lastReadSentIndex);
-                                        }
-                                    }
-
-                                    Connections {
-                                        target: chatModel
-                                        onLastReadSentMessageUpdated: {
-                                            console.log("[ChatModel] Messages in this chat were read, new last read: " + lastReadSentIndex + ", updating description for index " + index + ", status: " + (index <= lastReadSentIndex));
-                                            messageDateText.text = getMessageStatusText(display, index, lastReadSentIndex);
-                                        }
-                                        onMessageUpdated: {
-                                            if (index === modelIndex) {
-                                                console.log("[ChatModel] This message was updated, index " + index + ", updating content...");
-                                                messageDateText.text = getMessageStatusText(display, index, chatView.lastReadSentIndex);
-                                                messageText.text = Emoji.emojify(Functions.getMessageText(display, false), messageText.font.pixelSize);
-                                            }
-                                        }
+                                        documentData: ( content_type === "messageDocument" ) ?  display.content.document : ""
+                                        visible: content_type === "messageDocument"
                                     }
 
                                     Text {
@@ -616,9 +579,9 @@ Page {
 
                                         id: messageDateText
                                         font.pixelSize: Theme.fontSizeTiny
-                                        color: (chatPage.myUserId === display.sender_user_id) ? Theme.secondaryHighlightColor : Theme.secondaryColor
-                                        horizontalAlignment: (chatPage.myUserId === display.sender_user_id) ? Text.AlignRight : Text.AlignLeft
-                                        text: getMessageStatusText(display, index, chatView.lastReadSentIndex)
+                                        color: is_own ? Theme.secondaryHighlightColor : Theme.secondaryColor
+                                        horizontalAlignment: is_own ? Text.AlignRight : Text.AlignLeft
+                                        text: getMessageStatusText(is_edited, message_elapsed, send_state)
                                     }
 
                                 }
@@ -724,9 +687,24 @@ Page {
                     height: sendMessageColumn.height + Theme.paddingMedium
                     anchors.horizontalCenter: parent.horizontalCenter
 
+                    Column {
+                        anchors.bottom: parent.bottom
+                        anchors.bottomMargin: Theme.paddingSmall
+
+                        IconButton {
+                            id: attachImageButton
+                            icon.source: "image://theme/icon-m-image"
+                            anchors.horizontalCenter: parent.horizontalCenter
+                            enabled: newMessageColumn.editMessageId === "0"
+                            onClicked: {
+                                pageStack.push(imagePickerPage);
+                            }
+                        }
+                    }
+
                     Column {
                         id: sendMessageColumn
-                        width: parent.width - newMessageSendButton.width
+                        width: parent.width - attachImageButton.width - newMessageSendButton.width
                         anchors.verticalCenter: parent.verticalCenter
 
                         TextArea {
@@ -741,8 +719,8 @@ Page {
                                 if (!focus) {
                                     newMessageInReplyToRow.inReplyToMessage = null;
                                     if (newMessageColumn.editMessageId !== "0") {
-                                        newMessageColumn.editMessageId = "0";
                                         newMessageTextField.text = "";
+                                        newMessageColumn.editMessageId = "0";
                                     }
                                 }
                             }
@@ -766,6 +744,13 @@ Page {
                             }
 
                             onTextChanged: {
+                                // Both are debounced and throttled by the wrapper, so every keystroke may report them
+                                if (newMessageColumn.editMessageId === "0") {
+                                    tdLibWrapper.setChatDraftMessage(chatInformation.id, text, newMessageColumn.replyToMessageId);
+                                    if (focus && text.length > 0) {
+                                        tdLibWrapper.sendChatAction(chatInformation.id);
+                                    }
+                                }
                                 if (text.length === 0) {
                                     newMessageSendButton.enabled = false;
                                     if (tdLibWrapper.getSendByEnter()) {
@@ -24,8 +24,8 @@ CoverBackground {
 
     id: coverPage
 
-    property int unreadMessages: 0
-    property int unreadChats: 0
+    property int unreadMessages: unreadAggregator.unreadMessageCount
+    property int unreadChats: unreadAggregator.unreadChatCount
     property bool authenticated: false
     property int connectionState: TelegramAPI.WaitingForNetwork
 
@@ -64,21 +64,19 @@ CoverBackground {
     Component.onCompleted: {
         coverPage.authenticated = (tdLibWrapper.getAuthorizationState() === TelegramAPI.AuthorizationReady);
         coverPage.connectionState = tdLibWrapper.getConnectionState();
-        coverPage.unreadMessages = tdLibWrapper.getUnreadMessageInformation().unread_count;
-        coverPage.unreadChats = tdLibWrapper.getUnreadChatInformation().unread_count;
+        setUnreadInfoText();
+    }
+
+    onUnreadMessagesChanged: {
+        setUnreadInfoText();
+    }
+
+    onUnreadChatsChanged: {
         setUnreadInfoText();
     }
 
     Connections {
         target: tdLibWrapper
-        onUnreadMessageCountUpdated: {
-            coverPage.unreadMessages = messageCountInformation.unread_count;
-            setUnreadInfoText();
-        }
-        onUnreadChatCountUpdated: {
-            coverPage.unreadChats = chatCountInformation.unread_count;
-            setUnreadInfoText();
-        }
         onAuthorizationStateChanged: {
             coverPage.authenticated = (authorizationState === TelegramAPI.AuthorizationReady);
             setUnreadInfoText();
@@ -23,7 +23,6 @@ import Sailfish.Silica 1.0
 import Nemo.Notifications 1.0
 import WerkWolf.Fernschreiber 1.0
 import "../components"
-import "../js/twemoji.js" as Emoji
 import "../js/functions.js" as Functions
 
 Page {
@@ -51,7 +50,7 @@ Page {
                 if (status !== PageStatus.Active) {
                     pageStack.pop(pageStack.find( function(page){ return(page._depth === 0)} ), PageStackAction.Immediate);
                 }
-                pageStack.push(Qt.resolvedUrl("../pages/ChatPage.qml"), { "chatInformation" : tdLibWrapper.getChat(chatId) });
+                pageStack.push(Qt.resolvedUrl("../pages/ChatPage.qml"), { "chatInformation" : tdLibWrapper.getChat(chatId), "anchorMessageId" : messageId });
             }
         }
     }
@@ -215,11 +214,60 @@ Page {
                     anchors.fill: parent
 
                     clip: true
-                    visible: count > 0
+                    visible: count > 0 || chatListFilterModel.filterText !== "" || chatListFilterModel.chatFilter !== ChatListFilter.AllChats
                     opacity: overviewPage.chatListCreated ? 1 : 0
                     Behavior on opacity { NumberAnimation {} }
 
-                    model: chatListModel
+                    header: Column {
+                        width: chatListView.width
+
+                        SearchField {
+                            id: chatSearchField
+                            width: parent.width
+                            placeholderText: qsTr("Search chats")
+                            onTextChanged: {
+                                chatListFilterModel.filterText = text;
+                            }
+                            EnterKey.iconSource: "image://theme/icon-m-enter-close"
+                            EnterKey.onClicked: {
+                                focus = false;
+                            }
+                        }
+
+                        ComboBox {
+                            id: chatFilterComboBox
+                            width: parent.width
+                            label: qsTr("Show")
+                            menu: ContextMenu {
+                                MenuItem {
+                                    text: qsTr("All chats")
+                                    onClicked: chatListFilterModel.chatFilter = ChatListFilter.AllChats
+                                }
+                                MenuItem {
+                                    text: qsTr("Unread chats")
+                                    onClicked: chatListFilterModel.chatFilter = ChatListFilter.UnreadChats
+                                }
+                                MenuItem {
+                                    text: qsTr("Muted chats")
+                                    onClicked: chatListFilterModel.chatFilter = ChatListFilter.MutedChats
+                                }
+                                MenuItem {
+                                    text: qsTr("Groups")
+                                    onClicked: chatListFilterModel.chatFilter = ChatListFilter.GroupChats
+                                }
+                                MenuItem {
+                                    text: qsTr("Channels")
+                                    onClicked: chatListFilterModel.chatFilter = ChatListFilter.ChannelChats
+                                }
+                                MenuItem {
+                                    text: qsTr("Private chats")
+                                    onClicked: chatListFilterModel.chatFilter = ChatListFilter.PrivateChats
+                                }
+                            }
+                        }
+                    }
+
+                    model: chatListFilterModel
                     delegate: ListItem {
 
                         id: chatListViewItem
@@ -255,10 +303,9 @@ Page {
                                     chatListPictureThumbnail.photoData = (typeof display.photo !== "undefined") ? display.photo.small : "";
                                     chatUnreadMessagesCountBackground.visible = display.unread_count > 0;
                                     chatUnreadMessagesCount.text = display.unread_count > 99 ? "99+" : display.unread_count;
-                                    chatListNameText.text = display.title !== "" ? Emoji.emojify(display.title, Theme.fontSizeMedium) + ( display.notification_settings.mute_for > 0 ? Emoji.emojify(" 🔇", Theme.fontSizeMedium) : "" ) : qsTr("Unknown");
-                                    chatListLastUserText.text = (typeof display.last_message !== "undefined") ? ( display.last_message.sender_user_id !== overviewPage.ownUserId ? Emoji.emojify(Functions.getUserName(tdLibWrapper.getUserInformation(display.last_message.sender_user_id)), Theme.fontSizeExtraSmall) : qsTr("You") ) : qsTr("Unknown");
-                                    chatListLastMessageText.text = (typeof display.last_message !== "undefined") ? Emoji.emojify(Functions.getMessageText(display.last_message, true), Theme.fontSizeExtraSmall) : qsTr("Unknown");
-                                    messageContactTimeElapsedText.text = (typeof display.last_message !== "undefined") ? Functions.getDateTimeElapsed(display.last_message.date) : qsTr("Unknown");
+                                    chatListNameText.text = chat_title;
+                                    chatListLastUserText.text = last_message_sender;
+                                    chatListLastMessageText.text = last_message_text;
                                 }
                             }
                         }
@@ -328,7 +375,7 @@ Page {
 
                                     Text {
                                         id: chatListNameText
-                                        text: display.title !== "" ? Emoji.emojify(display.title, Theme.fontSizeMedium) + ( display.notification_settings.mute_for > 0 ? Emoji.emojify(" 🔇", Theme.fontSizeMedium) : "" ) : qsTr("Unknown")
+                                        text: chat_title
                                         textFormat: Text.StyledText
                                         font.pixelSize: Theme.fontSizeMedium
                                         color: Theme.primaryColor
@@ -349,7 +396,7 @@ Page {
                                         spacing: Theme.paddingSmall
                                         Text {
                                             id: chatListLastUserText
-                                            text: (typeof display.last_message !== "undefined") ? ( display.last_message.sender_user_id !== overviewPage.ownUserId ? Emoji.emojify(Functions.getUserName(tdLibWrapper.getUserInformation(display.last_message.sender_user_id)), font.pixelSize) : qsTr("You") ) : qsTr("Unknown")
+                                            text: last_message_sender
                                             font.pixelSize: Theme.fontSizeExtraSmall
                                             color: Theme.highlightColor
                                             textFormat: Text.StyledText
@@ -363,7 +410,7 @@ Page {
                                         }
                                         Text {
                                             id: chatListLastMessageText
-                                            text: (typeof display.last_message !== "undefined") ? Emoji.emojify(Functions.getMessageText(display.last_message, true), Theme.fontSizeExtraSmall) : qsTr("Unknown")
+                                            text: last_message_text
                                             font.pixelSize: Theme.fontSizeExtraSmall
                                             color: Theme.primaryColor
                                             width: parent.width - Theme.paddingMedium - chatListLastUserText.width
@@ -379,28 +426,9 @@ Page {
                                         }
                                     }
 
-                                    Timer {
-                                        id: messageContactTimeUpdater
-                                        interval: 60000
-                                        running: true
-                                        repeat: true
-                                        onTriggered: {
-                                            if (typeof display.last_message !== "undefined") {
-                                                messageContactTimeElapsedText.text = Functions.getDateTimeElapsed(display.last_message.date);
-                                                // Force update of all list item elements. dataChanged() doesn't seem to trigger them all :(
-                                                chatListPictureThumbnail.photoData = (typeof display.photo !== "undefined") ? display.photo.small : "";
-                                                chatUnreadMessagesCountBackground.visible = display.unread_count > 0;
-                                                chatUnreadMessagesCount.text = display.unread_count > 99 ? "99+" : display.unread_count;
-                                                chatListNameText.text = display.title !== "" ? Emoji.emojify(display.title, Theme.fontSizeMedium) + ( display.notification_settings.mute_for > 0 ? Emoji.emojify(" 🔇", Theme.fontSizeMedium) : "" ) : qsTr("Unknown");
-                                                chatListLastUserText.text = (typeof display.last_message !== "undefined") ? ( display.last_message.sender_user_id !== overviewPage.ownUserId ? Emoji.emojify(Functions.getUserName(tdLibWrapper.getUserInformation(display.last_message.sender_user_id)), Theme.fontSizeExtraSmall) : qsTr("You") ) : qsTr("Unknown");
-                                                chatListLastMessageText.text = (typeof display.last_message !== "undefined") ? Emoji.emojify(Functions.getMessageText(display.last_message, true), Theme.fontSizeExtraSmall) : qsTr("Unknown");
-                                            }
-                                        }
-                                    }
-
                                     Text {
                                         id: messageContactTimeElapsedText
-                                        text: (typeof display.last_message !== "undefined") ? Functions.getDateTimeElapsed(display.last_message.date) : qsTr("Unknown")
+                                        text: last_message_elapsed
                                         font.pixelSize: Theme.fontSizeTiny
                                         color: Theme.secondaryColor
                                     }
@@ -52,6 +52,25 @@ Page {
                 }
             }
 
+            ComboBox {
+                id: messageWindowSizeComboBox
+                property var messageWindowSizes: [ 250, 500, 1000, 2000 ]
+                label: qsTr("Messages kept in memory")
+                description: qsTr("Older messages are loaded again from the local database when you scroll back to them")
+                currentIndex: Math.max(0, messageWindowSizes.indexOf(tdLibWrapper.getMessageWindowSize()))
+                menu: ContextMenu {
+                    Repeater {
+                        model: messageWindowSizeComboBox.messageWindowSizes
+                        MenuItem {
+                            text: modelData
+                        }
+                    }
+                }
+                onCurrentIndexChanged: {
+                    tdLibWrapper.setMessageWindowSize(messageWindowSizes[currentIndex]);
+                }
+            }
+
             VerticalScrollDecorator {}
         }
 
@@ -0,0 +1,114 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "chatlistfiltermodel.h"
+#include <QElapsedTimer>
+#include <QDebug>
+
+ChatListFilterModel::ChatListFilterModel(ChatListModel *chatListModel, QObject *parent) : QSortFilterProxyModel(parent)
+{
+    this->chatListModel = chatListModel;
+    this->chatFilter = AllChats;
+    // Changed rows are re-evaluated by the proxy itself, so read and order updates never trigger a full rescan
+    this->setDynamicSortFilter(true);
+    this->setSourceModel(chatListModel);
+    connect(this->chatListModel, SIGNAL(chatTitleIndexed(QString)), this, SLOT(handleChatTitleIndexed(QString)));
+}
+
+ChatListFilterModel::~ChatListFilterModel()
+{
+    qDebug() << "[ChatListFilterModel] Destroying myself...";
+}
+
+QString ChatListFilterModel::getFilterText() const
+{
+    return this->filterText;
+}
+
+void ChatListFilterModel::setFilterText(const QString &filterText)
+{
+    if (this->filterText == filterText) {
+        return;
+    }
+    QElapsedTimer searchTimer;
+    searchTimer.start();
+    this->filterText = filterText;
+    this->searchTerms = ChatSearchIndex::tokenize(filterText);
+    this->matchingChatIds = this->chatListModel->getSearchIndex().search(this->searchTerms);
+    this->invalidateFilter();
+    qDebug() << "[ChatListFilterModel] Search for" << this->searchTerms << "found" << this->matchingChatIds.size() << "chats in" << searchTimer.nsecsElapsed() / 1000 << "microseconds";
+    emit filterTextChanged();
+}
+
+ChatListFilterModel::ChatFilter ChatListFilterModel::getChatFilter() const
+{
+    return this->chatFilter;
+}
+
+void ChatListFilterModel::setChatFilter(const ChatListFilterModel::ChatFilter &chatFilter)
+{
+    if (this->chatFilter == chatFilter) {
+        return;
+    }
+    qDebug() << "[ChatListFilterModel] Changing chat filter to" << chatFilter;
+    this->chatFilter = chatFilter;
+    this->invalidateFilter();
+    emit chatFilterChanged();
+}
+
+void ChatListFilterModel::handleChatTitleIndexed(const QString &chatId)
+{
+    if (this->searchTerms.isEmpty()) {
+        return;
+    }
+    if (this->chatListModel->getSearchIndex().matches(chatId, this->searchTerms)) {
+        this->matchingChatIds.insert(chatId);
+    } else {
+        this->matchingChatIds.remove(chatId);
+    }
+}
+
+bool ChatListFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    QVariantMap chatInformation = this->chatListModel->data(this->chatListModel->index(sourceRow, 0, sourceParent), Qt::DisplayRole).toMap();
+    if (!this->searchTerms.isEmpty() && !this->matchingChatIds.contains(chatInformation.value("id").toString())) {
+        return false;
+    }
+    return this->acceptsChat(chatInformation);
+}
+
+bool ChatListFilterModel::acceptsChat(const QVariantMap &chatInformation) const
+{
+    QVariantMap chatType = chatInformation.value("type").toMap();
+    QString chatTypeName = chatType.value("@type").toString();
+    switch (this->chatFilter) {
+    case UnreadChats:
+        return chatInformation.value("unread_count").toInt() > 0 || chatInformation.value("is_marked_as_unread").toBool();
+    case MutedChats:
+        return chatInformation.value("notification_settings").toMap().value("mute_for").toInt() > 0;
+    case GroupChats:
+        return chatTypeName == "chatTypeBasicGroup" || ( chatTypeName == "chatTypeSupergroup" && !chatType.value("is_channel").toBool() );
+    case ChannelChats:
+        return chatTypeName == "chatTypeSupergroup" && chatType.value("is_channel").toBool();
+    case PrivateChats:
+        return chatTypeName == "chatTypePrivate" || chatTypeName == "chatTypeSecret";
+    default:
+        return true;
+    }
+}
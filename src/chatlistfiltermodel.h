@@ -0,0 +1,72 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CHATLISTFILTERMODEL_H
+#define CHATLISTFILTERMODEL_H
+
+#include <QSortFilterProxyModel>
+#include <QSet>
+#include <QStringList>
+#include "chatlistmodel.h"
+
+class ChatListFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString filterText READ getFilterText WRITE setFilterText NOTIFY filterTextChanged)
+    Q_PROPERTY(ChatFilter chatFilter READ getChatFilter WRITE setChatFilter NOTIFY chatFilterChanged)
+public:
+    explicit ChatListFilterModel(ChatListModel *chatListModel, QObject *parent = nullptr);
+    ~ChatListFilterModel() override;
+
+    enum ChatFilter {
+        AllChats,
+        UnreadChats,
+        MutedChats,
+        GroupChats,
+        ChannelChats,
+        PrivateChats
+    };
+    Q_ENUM(ChatFilter)
+
+    QString getFilterText() const;
+    void setFilterText(const QString &filterText);
+    ChatFilter getChatFilter() const;
+    void setChatFilter(const ChatFilter &chatFilter);
+
+signals:
+    void filterTextChanged();
+    void chatFilterChanged();
+
+public slots:
+    void handleChatTitleIndexed(const QString &chatId);
+
+protected:
+    virtual bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    ChatListModel *chatListModel;
+    QString filterText;
+    QStringList searchTerms;
+    QSet<QString> matchingChatIds;
+    ChatFilter chatFilter;
+
+    bool acceptsChat(const QVariantMap &chatInformation) const;
+};
+
+#endif // CHATLISTFILTERMODEL_H
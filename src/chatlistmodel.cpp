@@ -18,13 +18,18 @@
 */
 
 #include "chatlistmodel.h"
+#include "messageformatter.h"
 #include <QListIterator>
+#include <QGuiApplication>
 #include <QDebug>
 
-ChatListModel::ChatListModel(TDLibWrapper *tdLibWrapper)
+ChatListModel::ChatListModel(TDLibWrapper *tdLibWrapper, RelativeTimeClock *relativeTimeClock, EmojiEngine *emojiEngine)
 {
     this->tdLibWrapper = tdLibWrapper;
+    this->emojiEngine = emojiEngine;
     this->deltaUpdates = false;
+    this->deferredUpdates = false;
+    this->deferredOrderChange = false;
     connect(this->tdLibWrapper, SIGNAL(newChatDiscovered(QString, QVariantMap)), this, SLOT(handleChatDiscovered(QString, QVariantMap)));
     connect(this->tdLibWrapper, SIGNAL(chatLastMessageUpdated(QString, QString, QVariantMap)), this, SLOT(handleChatLastMessageUpdated(QString, QString, QVariantMap)));
     connect(this->tdLibWrapper, SIGNAL(chatOrderUpdated(QString, QString)), this, SLOT(handleChatOrderUpdated(QString, QString)));
@@ -32,6 +37,12 @@ ChatListModel::ChatListModel(TDLibWrapper *tdLibWrapper)
     connect(this->tdLibWrapper, SIGNAL(chatReadOutboxUpdated(QString, QString)), this, SLOT(handleChatReadOutboxUpdated(QString, QString)));
     connect(this->tdLibWrapper, SIGNAL(messageSendSucceeded(QString, QString, QVariantMap)), this, SLOT(handleMessageSendSucceeded(QString, QString, QVariantMap)));
     connect(this->tdLibWrapper, SIGNAL(chatNotificationSettingsUpdated(QString, QVariantMap)), this, SLOT(handleChatNotificationSettingsUpdated(QString, QVariantMap)));
+    connect(this->tdLibWrapper, SIGNAL(chatTitleUpdated(QString, QString)), this, SLOT(handleChatTitleUpdated(QString, QString)));
+    connect(this->tdLibWrapper, SIGNAL(chatDraftMessageUpdated(QString, QVariantMap)), this, SLOT(handleChatDraftMessageUpdated(QString, QVariantMap)));
+    connect(this->tdLibWrapper, SIGNAL(userUpdated(QString, QVariantMap)), this, SLOT(handleUserUpdated(QString, QVariantMap)));
+    connect(relativeTimeClock, SIGNAL(minuteChanged()), this, SLOT(handleMinuteChanged()));
+    connect(emojiEngine, SIGNAL(fontSizesChanged()), this, SLOT(handleFontSizesChanged()));
+    connect(qGuiApp, SIGNAL(applicationStateChanged(Qt::ApplicationState)), this, SLOT(handleApplicationStateChanged(Qt::ApplicationState)));
 }
 
 ChatListModel::~ChatListModel()
@@ -39,6 +50,17 @@ ChatListModel::~ChatListModel()
     qDebug() << "[ChatListModel] Destroying myself...";
 }
 
+QHash<int, QByteArray> ChatListModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles.insert(Qt::DisplayRole, "display");
+    roles.insert(ChatTitleRole, "chat_title");
+    roles.insert(LastMessageSenderRole, "last_message_sender");
+    roles.insert(LastMessageTextRole, "last_message_text");
+    roles.insert(LastMessageElapsedRole, "last_message_elapsed");
+    return roles;
+}
+
 int ChatListModel::rowCount(const QModelIndex &) const
 {
     return chatList.size();
@@ -46,10 +68,25 @@ int ChatListModel::rowCount(const QModelIndex &) const
 
 QVariant ChatListModel::data(const QModelIndex &index, int role) const
 {
-    if(index.isValid() && role == Qt::DisplayRole) {
+    if (!index.isValid()) {
+        return QVariant();
+    }
+    switch (role) {
+    case Qt::DisplayRole:
         return QVariant(chatList.value(index.row()));
+    case ChatTitleRole:
+        return QVariant(getChatPresentation(chatList.value(index.row()).toMap()).title);
+    case LastMessageSenderRole:
+        return QVariant(getChatPresentation(chatList.value(index.row()).toMap()).lastMessageSender);
+    case LastMessageTextRole:
+        return QVariant(getChatPresentation(chatList.value(index.row()).toMap()).lastMessageText);
+    case LastMessageElapsedRole: {
+        QVariantMap lastMessage = chatList.value(index.row()).toMap().value("last_message").toMap();
+        return QVariant(lastMessage.isEmpty() ? tr("Unknown") : MessageFormatter::getDateTimeElapsed(lastMessage.value("date").toLongLong()));
+    }
+    default:
+        return QVariant();
     }
-    return QVariant();
 }
 
 bool ChatListModel::insertRows(int row, int count, const QModelIndex &parent)
@@ -75,6 +112,11 @@ void ChatListModel::redrawModel()
     layoutChanged();
 }
 
+const ChatSearchIndex &ChatListModel::getSearchIndex() const
+{
+    return this->searchIndex;
+}
+
 bool compareChats(const QVariant &chat1, const QVariant &chat2)
 {
     QVariantMap chatMap1 = chat1.toMap();
@@ -96,6 +138,8 @@ void ChatListModel::handleChatDiscovered(const QString &chatId, const QVariantMa
     this->chatListMutex.lock();
     qDebug() << "[ChatListModel] Adding new chat " << chatId;
     this->chatToBeAdded = chatInformation;
+    this->searchIndex.setChatTitle(chatId, chatInformation.value("title").toString());
+    emit chatTitleIndexed(chatId);
     insertRows(rowCount(QModelIndex()), 1);
     this->chatListMutex.unlock();
 }
@@ -111,10 +155,9 @@ void ChatListModel::handleChatLastMessageUpdated(const QString &chatId, const QS
     currentChat.insert("last_message", lastMessage);
     currentChat.insert("order", order);
     this->chatList.replace(chatIndex, currentChat);
-    emit dataChanged(this->index(chatIndex), this->index(chatIndex));
-
+    this->presentationCache.remove(chatId);
     this->updateChatOrder(chatIndex, currentChat);
-    emit chatChanged(chatId);
+    this->announceChatChanged(chatId);
 
     this->chatListMutex.unlock();
 }
@@ -127,10 +170,8 @@ void ChatListModel::handleChatOrderUpdated(const QString &chatId, const QString
     QVariantMap currentChat = this->chatList.at(chatIndex).toMap();
     currentChat.insert("order", order);
     this->chatList.replace(chatIndex, currentChat);
-    emit dataChanged(this->index(chatIndex), this->index(chatIndex));
-
     this->updateChatOrder(chatIndex, currentChat);
-    emit chatChanged(chatId);
+    this->announceChatChanged(chatId);
 
     this->chatListMutex.unlock();
 }
@@ -144,8 +185,7 @@ void ChatListModel::handleChatReadInboxUpdated(const QString &chatId, const QStr
     currentChat.insert("unread_count", unreadCount);
     currentChat.insert("last_read_inbox_message_id", lastReadInboxMessageId);
     this->chatList.replace(chatIndex, currentChat);
-    emit dataChanged(this->index(chatIndex), this->index(chatIndex));
-    emit chatChanged(chatId);
+    this->announceChatChanged(chatId);
     this->chatListMutex.unlock();
 }
 
@@ -157,8 +197,7 @@ void ChatListModel::handleChatReadOutboxUpdated(const QString &chatId, const QSt
     QVariantMap currentChat = this->chatList.at(chatIndex).toMap();
     currentChat.insert("last_read_outbox_message_id", lastReadOutboxMessageId);
     this->chatList.replace(chatIndex, currentChat);
-    emit dataChanged(this->index(chatIndex), this->index(chatIndex));
-    emit chatChanged(chatId);
+    this->announceChatChanged(chatId);
     this->chatListMutex.unlock();
 }
 
@@ -171,8 +210,8 @@ void ChatListModel::handleMessageSendSucceeded(const QString &messageId, const Q
     QVariantMap currentChat = this->chatList.value(chatIndex).toMap();
     currentChat.insert("last_message", message);
     this->chatList.replace(chatIndex, currentChat);
-    emit dataChanged(this->index(chatIndex), this->index(chatIndex));
-    emit chatChanged(chatId);
+    this->presentationCache.remove(chatId);
+    this->announceChatChanged(chatId);
 
     this->chatListMutex.unlock();
 }
@@ -185,14 +224,188 @@ void ChatListModel::handleChatNotificationSettingsUpdated(const QString &chatId,
     QVariantMap currentChat = this->chatList.value(chatIndex).toMap();
     currentChat.insert("notification_settings", chatNotificationSettings);
     this->chatList.replace(chatIndex, currentChat);
+    this->presentationCache.remove(chatId);
+    this->announceChatChanged(chatId);
+
+    this->chatListMutex.unlock();
+}
+
+void ChatListModel::handleChatTitleUpdated(const QString &chatId, const QString &title)
+{
+    this->chatListMutex.lock();
+    int chatIndex = this->chatIndexMap.value(chatId).toInt();
+    qDebug() << "[ChatListModel] Updating title for chat " << chatId << " at index " << chatIndex;
+    QVariantMap currentChat = this->chatList.value(chatIndex).toMap();
+    currentChat.insert("title", title);
+    this->chatList.replace(chatIndex, currentChat);
+    this->presentationCache.remove(chatId);
+    // Filters need to know about the new title before they are asked about the changed row
+    this->searchIndex.setChatTitle(chatId, title);
+    emit chatTitleIndexed(chatId);
+    this->announceChatChanged(chatId);
+
+    this->chatListMutex.unlock();
+}
+
+void ChatListModel::handleChatDraftMessageUpdated(const QString &chatId, const QVariantMap &draftMessage)
+{
+    this->chatListMutex.lock();
+    int chatIndex = this->chatIndexMap.value(chatId).toInt();
+    qDebug() << "[ChatListModel] Updating draft message for chat " << chatId << " at index " << chatIndex;
+    QVariantMap currentChat = this->chatList.value(chatIndex).toMap();
+    // Kept in the chat information, so the chat page finds the draft when it is opened
+    currentChat.insert("draft_message", draftMessage);
+    this->chatList.replace(chatIndex, currentChat);
+    this->announceChatChanged(chatId);
+
+    this->chatListMutex.unlock();
+}
+
+void ChatListModel::handleUserUpdated(const QString &userId, const QVariantMap &userInformation)
+{
+    // Status updates arrive frequently, only a changed name of a shown sender is of interest here
+    if (!this->senderNames.contains(userId)) {
+        return;
+    }
+    QString userName = MessageFormatter::getUserName(userInformation);
+    if (this->senderNames.value(userId) == userName) {
+        return;
+    }
+    this->chatListMutex.lock();
+    qDebug() << "[ChatListModel] Name of last message sender changed " << userId;
+    this->senderNames.insert(userId, userName);
+    QStringList changedChatIds;
+    QMutableHashIterator<QString, ChatPresentation> presentationIterator(this->presentationCache);
+    while (presentationIterator.hasNext()) {
+        presentationIterator.next();
+        if (presentationIterator.value().lastMessageSenderId == userId) {
+            changedChatIds.append(presentationIterator.key());
+            presentationIterator.remove();
+        }
+    }
+    QVector<int> changedRoles;
+    changedRoles.append(LastMessageSenderRole);
+    QListIterator<QString> changedChatIdIterator(changedChatIds);
+    while (changedChatIdIterator.hasNext()) {
+        QString changedChatId = changedChatIdIterator.next();
+        if (this->deferredUpdates) {
+            this->deferredChatIds.insert(changedChatId);
+        } else {
+            int chatIndex = this->chatIndexMap.value(changedChatId).toInt();
+            emit dataChanged(this->index(chatIndex), this->index(chatIndex), changedRoles);
+        }
+    }
+    this->chatListMutex.unlock();
+}
+
+void ChatListModel::handleMinuteChanged()
+{
+    // Only the elapsed time is outdated, views just refresh the delegates they currently have
+    if (this->chatList.isEmpty()) {
+        return;
+    }
+    QVector<int> changedRoles;
+    changedRoles.append(LastMessageElapsedRole);
+    emit dataChanged(this->index(0), this->index(this->chatList.size() - 1), changedRoles);
+}
+
+void ChatListModel::handleFontSizesChanged()
+{
+    this->presentationCache.clear();
+    if (this->chatList.isEmpty()) {
+        return;
+    }
+    QVector<int> changedRoles;
+    changedRoles.append(ChatTitleRole);
+    changedRoles.append(LastMessageSenderRole);
+    changedRoles.append(LastMessageTextRole);
+    emit dataChanged(this->index(0), this->index(this->chatList.size() - 1), changedRoles);
+}
+
+void ChatListModel::handleApplicationStateChanged(Qt::ApplicationState applicationState)
+{
+    if (applicationState == Qt::ApplicationActive) {
+        if (this->deferredUpdates) {
+            this->chatListMutex.lock();
+            this->deferredUpdates = false;
+            this->applyDeferredUpdates();
+            this->chatListMutex.unlock();
+        }
+    } else if (!this->deferredUpdates) {
+        qDebug() << "[ChatListModel] Application not active, deferring UI updates";
+        this->deferredUpdates = true;
+    }
+}
+
+void ChatListModel::announceChatChanged(const QString &chatId)
+{
+    // Nobody looks at the list while we're in the background, changes are announced when we're back
+    if (this->deferredUpdates) {
+        this->deferredChatIds.insert(chatId);
+        return;
+    }
+    int chatIndex = this->chatIndexMap.value(chatId).toInt();
     emit dataChanged(this->index(chatIndex), this->index(chatIndex));
     emit chatChanged(chatId);
+}
 
-    this->chatListMutex.unlock();
+void ChatListModel::applyDeferredUpdates()
+{
+    qDebug() << "[ChatListModel] Application active again, applying deferred updates for" << this->deferredChatIds.size() << "chats, order changed:" << this->deferredOrderChange;
+    if (this->deferredOrderChange) {
+        // All order changes collected in the background result in one single sort
+        this->deferredOrderChange = false;
+        emit layoutAboutToBeChanged();
+        QModelIndexList previousIndexes = this->persistentIndexList();
+        QStringList persistentChatIds;
+        QListIterator<QModelIndex> previousIndexIterator(previousIndexes);
+        while (previousIndexIterator.hasNext()) {
+            persistentChatIds.append(this->chatList.at(previousIndexIterator.next().row()).toMap().value("id").toString());
+        }
+        std::sort(this->chatList.begin(), this->chatList.end(), compareChats);
+        this->chatIndexMap.clear();
+        for (int i = 0; i < this->chatList.length(); i++) {
+            this->chatIndexMap.insert(this->chatList.at(i).toMap().value("id").toString(), i);
+        }
+        QModelIndexList currentIndexes;
+        QListIterator<QString> persistentChatIdIterator(persistentChatIds);
+        while (persistentChatIdIterator.hasNext()) {
+            currentIndexes.append(this->index(this->chatIndexMap.value(persistentChatIdIterator.next()).toInt()));
+        }
+        this->changePersistentIndexList(previousIndexes, currentIndexes);
+        emit layoutChanged();
+    }
+
+    // Changed rows are announced as contiguous ranges
+    QList<int> changedRows;
+    QSetIterator<QString> deferredChatIdIterator(this->deferredChatIds);
+    while (deferredChatIdIterator.hasNext()) {
+        changedRows.append(this->chatIndexMap.value(deferredChatIdIterator.next()).toInt());
+    }
+    std::sort(changedRows.begin(), changedRows.end());
+    int rangeStart = 0;
+    while (rangeStart < changedRows.size()) {
+        int rangeEnd = rangeStart;
+        while (rangeEnd + 1 < changedRows.size() && changedRows.at(rangeEnd + 1) == changedRows.at(rangeEnd) + 1) {
+            rangeEnd++;
+        }
+        emit dataChanged(this->index(changedRows.at(rangeStart)), this->index(changedRows.at(rangeEnd)));
+        rangeStart = rangeEnd + 1;
+    }
+    QSetIterator<QString> changedChatIdIterator(this->deferredChatIds);
+    while (changedChatIdIterator.hasNext()) {
+        emit chatChanged(changedChatIdIterator.next());
+    }
+    this->deferredChatIds.clear();
 }
 
 void ChatListModel::updateChatOrder(const int &currentChatIndex, const QVariantMap &updatedChat)
 {
+    if (this->deferredUpdates) {
+        this->deferredOrderChange = true;
+        return;
+    }
+
     // Finding the new position manually as information is needed by beginMoveRows()
     // This seems to be the most convenient way of persisting the list position while changing the items
     // Other alternative layoutChanged() after sorting resets the index position - there we would need to calculate the new position as well
@@ -228,3 +441,50 @@ void ChatListModel::updateChatOrder(const int &currentChatIndex, const QVariantM
 
     }
 }
+
+const ChatListModel::ChatPresentation &ChatListModel::getChatPresentation(const QVariantMap &chatInformation) const
+{
+    // Presentation strings are computed once per change of the chat and then served from the cache
+    QString chatId = chatInformation.value("id").toString();
+    QHash<QString, ChatPresentation>::const_iterator cachedPresentation = this->presentationCache.constFind(chatId);
+    if (cachedPresentation != this->presentationCache.constEnd()) {
+        return cachedPresentation.value();
+    }
+
+    ChatPresentation chatPresentation;
+    QString title = chatInformation.value("title").toString();
+    if (title.isEmpty()) {
+        chatPresentation.title = tr("Unknown");
+    } else {
+        chatPresentation.title = MessageFormatter::escapeHtml(title);
+        if (chatInformation.value("notification_settings").toMap().value("mute_for").toInt() > 0) {
+            chatPresentation.title.append(QString::fromUtf8(" \xF0\x9F\x94\x87"));
+        }
+        chatPresentation.title = this->emojiEngine->emojify(chatPresentation.title, EmojiEngine::MediumFont);
+    }
+    if (chatInformation.contains("last_message")) {
+        QVariantMap lastMessage = chatInformation.value("last_message").toMap();
+        chatPresentation.lastMessageSenderId = lastMessage.value("sender_user_id").toString();
+        if (chatPresentation.lastMessageSenderId == this->tdLibWrapper->getUserInformation().value("id").toString()) {
+            chatPresentation.lastMessageSender = tr("You");
+        } else {
+            chatPresentation.lastMessageSender = this->emojiEngine->emojify(MessageFormatter::escapeHtml(this->getSenderName(chatPresentation.lastMessageSenderId)), EmojiEngine::ExtraSmallFont);
+        }
+        chatPresentation.lastMessageText = this->emojiEngine->emojify(MessageFormatter::escapeHtml(MessageFormatter::getMessageText(lastMessage)), EmojiEngine::ExtraSmallFont);
+    } else {
+        chatPresentation.lastMessageSender = tr("Unknown");
+        chatPresentation.lastMessageText = tr("Unknown");
+    }
+    return this->presentationCache.insert(chatId, chatPresentation).value();
+}
+
+QString ChatListModel::getSenderName(const QString &userId) const
+{
+    QHash<QString, QString>::const_iterator senderName = this->senderNames.constFind(userId);
+    if (senderName != this->senderNames.constEnd()) {
+        return senderName.value();
+    }
+    QString userName = MessageFormatter::getUserName(this->tdLibWrapper->getUserInformation(userId));
+    this->senderNames.insert(userId, userName);
+    return userName;
+}
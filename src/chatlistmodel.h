@@ -23,15 +23,27 @@
 #include <QAbstractListModel>
 #include <QDebug>
 #include <QMutex>
+#include <QSet>
 #include "tdlibwrapper.h"
+#include "relativetimeclock.h"
+#include "emojiengine.h"
+#include "chatsearchindex.h"
 
 class ChatListModel : public QAbstractListModel
 {
     Q_OBJECT
 public:
-    ChatListModel(TDLibWrapper *tdLibWrapper);
+    ChatListModel(TDLibWrapper *tdLibWrapper, RelativeTimeClock *relativeTimeClock, EmojiEngine *emojiEngine);
     ~ChatListModel() override;
 
+    enum ChatListRole {
+        ChatTitleRole = Qt::UserRole + 1,
+        LastMessageSenderRole,
+        LastMessageTextRole,
+        LastMessageElapsedRole
+    };
+
+    virtual QHash<int, QByteArray> roleNames() const override;
     virtual int rowCount(const QModelIndex&) const override;
     virtual QVariant data(const QModelIndex &index, int role) const override;
     virtual bool insertRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
@@ -39,8 +51,11 @@ public:
     Q_INVOKABLE void enableDeltaUpdates();
     Q_INVOKABLE void redrawModel();
 
+    const ChatSearchIndex &getSearchIndex() const;
+
 signals:
     void chatChanged(const QString &chatId);
+    void chatTitleIndexed(const QString &chatId);
 
 public slots:
     void handleChatDiscovered(const QString &chatId, const QVariantMap &chatInformation);
@@ -50,16 +65,42 @@ public slots:
     void handleChatReadOutboxUpdated(const QString &chatId, const QString &lastReadOutboxMessageId);
     void handleMessageSendSucceeded(const QString &messageId, const QString &oldMessageId, const QVariantMap &message);
     void handleChatNotificationSettingsUpdated(const QString &chatId, const QVariantMap &chatNotificationSettings);
+    void handleChatTitleUpdated(const QString &chatId, const QString &title);
+    void handleChatDraftMessageUpdated(const QString &chatId, const QVariantMap &draftMessage);
+    void handleUserUpdated(const QString &userId, const QVariantMap &userInformation);
+    void handleMinuteChanged();
+    void handleFontSizesChanged();
+
+private slots:
+    void handleApplicationStateChanged(Qt::ApplicationState applicationState);
 
 private:
+    struct ChatPresentation {
+        QString title;
+        QString lastMessageSenderId;
+        QString lastMessageSender;
+        QString lastMessageText;
+    };
+
     TDLibWrapper *tdLibWrapper;
+    EmojiEngine *emojiEngine;
     QVariantList chatList;
     QVariantMap chatToBeAdded;
     QVariantMap chatIndexMap;
     QMutex chatListMutex;
+    ChatSearchIndex searchIndex;
+    mutable QHash<QString, ChatPresentation> presentationCache;
+    mutable QHash<QString, QString> senderNames;
     bool deltaUpdates;
+    bool deferredUpdates;
+    bool deferredOrderChange;
+    QSet<QString> deferredChatIds;
 
+    void announceChatChanged(const QString &chatId);
+    void applyDeferredUpdates();
     void updateChatOrder(const int &currentChatIndex, const QVariantMap &updatedChat);
+    const ChatPresentation &getChatPresentation(const QVariantMap &chatInformation) const;
+    QString getSenderName(const QString &userId) const;
 
 };
 
@@ -18,24 +18,72 @@
 */
 
 #include "chatmodel.h"
+#include "messageformatter.h"
 
-#include <QListIterator>
 #include <QByteArray>
-#include <QBitArray>
+#include <QDateTime>
+#include <QGuiApplication>
+#include <QListIterator>
+#include <algorithm>
+
+namespace {
+
+    const int HISTORY_PAGE_SIZE = 50;
+    const int MINIMUM_MESSAGE_WINDOW_SIZE = 2 * HISTORY_PAGE_SIZE;
+    const int CHAT_STATE_CACHE_BUDGET = 2000;
+    const int REPLY_PREVIEW_CACHE_SIZE = 1000;
+    const int REPLY_PREVIEW_REQUEST_DELAY = 50;
+    const int VIEW_MESSAGES_INTERVAL = 1000;
+
+}
 
-ChatModel::ChatModel(TDLibWrapper *tdLibWrapper)
+ChatModel::ChatModel(TDLibWrapper *tdLibWrapper, RelativeTimeClock *relativeTimeClock, EmojiEngine *emojiEngine)
 {
     this->tdLibWrapper = tdLibWrapper;
+    this->emojiEngine = emojiEngine;
+    this->replyPreviews.setMaxCost(REPLY_PREVIEW_CACHE_SIZE);
+    this->replyPreviewTimer.setSingleShot(true);
+    this->replyPreviewTimer.setInterval(REPLY_PREVIEW_REQUEST_DELAY);
+    connect(&this->replyPreviewTimer, SIGNAL(timeout()), this, SLOT(requestReplyPreviews()));
+    this->viewMessagesTimer.setSingleShot(true);
+    this->viewMessagesTimer.setInterval(VIEW_MESSAGES_INTERVAL);
+    connect(&this->viewMessagesTimer, SIGNAL(timeout()), this, SLOT(flushViewedMessages()));
+    this->cachedMessageCount = 0;
     this->inReload = false;
     this->inIncrementalUpdate = false;
+    this->loadingNewerMessages = false;
+    this->hasNewerMessages = false;
+    this->messageWindowSize = qMax(this->tdLibWrapper->getMessageWindowSize(), MINIMUM_MESSAGE_WINDOW_SIZE);
+    this->lowestLoadedMessageId = 0;
+    this->highestLoadedMessageId = 0;
+    this->inLocalHistoryRequest = false;
+    this->historyRequestFromMessageId = 0;
+    this->historyRequestOffset = 0;
+    this->networkTopUpPending = false;
+    this->inNetworkTopUp = false;
+    this->initialFromMessageId = 0;
+    this->initialOffset = 0;
+    this->inGapFill = false;
+    this->gapFillMessageId = 0;
+    this->deferredUpdates = false;
+    this->deferredReadInboxUpdate = false;
+    this->deferredReadOutboxUpdate = false;
     connect(this->tdLibWrapper, SIGNAL(messagesReceived(QVariantList)), this, SLOT(handleMessagesReceived(QVariantList)));
     connect(this->tdLibWrapper, SIGNAL(newMessageReceived(QString, QVariantMap)), this, SLOT(handleNewMessageReceived(QString, QVariantMap)));
     connect(this->tdLibWrapper, SIGNAL(chatReadInboxUpdated(QString, QString, int)), this, SLOT(handleChatReadInboxUpdated(QString, QString, int)));
     connect(this->tdLibWrapper, SIGNAL(chatReadOutboxUpdated(QString, QString)), this, SLOT(handleChatReadOutboxUpdated(QString, QString)));
     connect(this->tdLibWrapper, SIGNAL(messageSendSucceeded(QString, QString, QVariantMap)), this, SLOT(handleMessageSendSucceeded(QString, QString, QVariantMap)));
+    connect(this->tdLibWrapper, SIGNAL(messageSendFailed(QString, QString, QVariantMap)), this, SLOT(handleMessageSendFailed(QString, QString, QVariantMap)));
     connect(this->tdLibWrapper, SIGNAL(chatNotificationSettingsUpdated(QString, QVariantMap)), this, SLOT(handleChatNotificationSettingsUpdated(QString, QVariantMap)));
     connect(this->tdLibWrapper, SIGNAL(messageContentUpdated(QString, QString, QVariantMap)), this, SLOT(handleMessageContentUpdated(QString, QString, QVariantMap)));
+    connect(this->tdLibWrapper, SIGNAL(messageEdited(QString, QString, int)), this, SLOT(handleMessageEdited(QString, QString, int)));
+    connect(this->tdLibWrapper, SIGNAL(messageViewsUpdated(QString, QString, int)), this, SLOT(handleMessageViewsUpdated(QString, QString, int)));
     connect(this->tdLibWrapper, SIGNAL(messagesDeleted(QString, QVariantList)), this, SLOT(handleMessagesDeleted(QString, QVariantList)));
+    connect(this->tdLibWrapper, SIGNAL(userUpdated(QString, QVariantMap)), this, SLOT(handleUserUpdated(QString, QVariantMap)));
+    connect(this->tdLibWrapper, SIGNAL(messagesFetched(QString, QVariantList, QVariantList)), this, SLOT(handleMessagesFetched(QString, QVariantList, QVariantList)));
+    connect(relativeTimeClock, SIGNAL(minuteChanged()), this, SLOT(handleMinuteChanged()));
+    connect(emojiEngine, SIGNAL(fontSizesChanged()), this, SLOT(handleFontSizesChanged()));
+    connect(qGuiApp, SIGNAL(applicationStateChanged(Qt::ApplicationState)), this, SLOT(handleApplicationStateChanged(Qt::ApplicationState)));
 }
 
 ChatModel::~ChatModel()
@@ -43,6 +91,28 @@ ChatModel::~ChatModel()
     qDebug() << "[ChatModel] Destroying myself...";
 }
 
+QHash<int, QByteArray> ChatModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles.insert(Qt::DisplayRole, "display");
+    roles.insert(MessageElapsedRole, "message_elapsed");
+    roles.insert(MessageTextRole, "message_text");
+    roles.insert(ContentTypeRole, "content_type");
+    roles.insert(OwnMessageRole, "is_own");
+    roles.insert(SenderNameRole, "sender_name");
+    roles.insert(SenderPhotoRole, "sender_photo");
+    roles.insert(SendStateRole, "send_state");
+    roles.insert(EditedRole, "is_edited");
+    roles.insert(ViewCountRole, "view_count");
+    roles.insert(ReplyPreviewRole, "reply_preview");
+    roles.insert(FirstInRunRole, "is_first_in_run");
+    roles.insert(LastInRunRole, "is_last_in_run");
+    roles.insert(AlbumIndexRole, "album_index");
+    roles.insert(DayBoundaryRole, "is_day_boundary");
+    roles.insert(WaveformRole, "voice_waveform");
+    return roles;
+}
+
 int ChatModel::rowCount(const QModelIndex &) const
 {
     return messages.size();
@@ -50,10 +120,47 @@ int ChatModel::rowCount(const QModelIndex &) const
 
 QVariant ChatModel::data(const QModelIndex &index, int role) const
 {
-    if(index.isValid() && role == Qt::DisplayRole) {
+    if (!index.isValid()) {
+        return QVariant();
+    }
+    switch (role) {
+    case Qt::DisplayRole:
         return QVariant(messages.value(index.row()));
+    case MessageElapsedRole:
+        return QVariant(MessageFormatter::getDateTimeElapsed(messages.value(index.row()).toMap().value("date").toLongLong()));
+    case MessageTextRole:
+        return QVariant(this->getRenderedText(messages.value(index.row()).toMap()));
+    case ContentTypeRole:
+        return QVariant(messages.value(index.row()).toMap().value("content").toMap().value("@type"));
+    case OwnMessageRole:
+        return QVariant(messages.value(index.row()).toMap().value("sender_user_id").toString() == this->ownUserId);
+    case SenderNameRole: {
+        QString senderUserId = messages.value(index.row()).toMap().value("sender_user_id").toString();
+        return QVariant(senderUserId == this->ownUserId ? tr("You") : this->getSender(senderUserId).name);
+    }
+    case SenderPhotoRole:
+        return this->getSender(messages.value(index.row()).toMap().value("sender_user_id").toString()).photo;
+    case SendStateRole:
+        return QVariant(this->getSendState(messages.value(index.row()).toMap()));
+    case EditedRole:
+        return QVariant(messages.value(index.row()).toMap().value("edit_date").toInt() > 0);
+    case ViewCountRole:
+        return QVariant(messages.value(index.row()).toMap().value("views").toInt());
+    case ReplyPreviewRole:
+        return QVariant(this->getReplyPreview(messages.value(index.row()).toMap()));
+    case FirstInRunRole:
+        return QVariant(messageGroupings.value(index.row()).firstInRun);
+    case LastInRunRole:
+        return QVariant(messageGroupings.value(index.row()).lastInRun);
+    case AlbumIndexRole:
+        return QVariant(messageGroupings.value(index.row()).albumIndex);
+    case DayBoundaryRole:
+        return QVariant(messageGroupings.value(index.row()).dayBoundary);
+    case WaveformRole:
+        return QVariant(this->getWaveform(messages.value(index.row()).toMap()));
+    default:
+        return QVariant();
     }
-    return QVariant();
 }
 
 bool ChatModel::insertRows(int row, int count, const QModelIndex &parent)
@@ -62,29 +169,125 @@ bool ChatModel::insertRows(int row, int count, const QModelIndex &parent)
     beginInsertRows(parent, row, row + count - 1);
     for (int i = 0; i < count; i++) {
         this->messages.insert(row + i, this->messagesToBeAdded.at(i));
+        this->messageIds.insert(row + i, this->messagesToBeAdded.at(i).toMap().value("id").toLongLong());
+    }
+    this->messageGroupings.insert(row, count, MessageGrouping());
+    for (int i = row; i < row + count; i++) {
+        this->updateMessageGrouping(i);
     }
-    this->calculateMessageIndexMap();
     endInsertRows();
+    this->updateAdjacentGroupings(row, row + count - 1);
     return true;
 }
 
 void ChatModel::initialize(const QVariantMap &chatInformation)
 {
-    qDebug() << "[ChatModel] Initializing chat model...";
+    this->initialize(chatInformation, chatInformation.value("last_read_inbox_message_id").toString());
+}
+
+void ChatModel::initialize(const QVariantMap &chatInformation, const QString &anchorMessageId)
+{
+    qDebug() << "[ChatModel] Initializing chat model at message" << anchorMessageId;
+    this->flushViewedMessages();
+    this->storeChatState();
+    beginResetModel();
     this->chatInformation = chatInformation;
     this->messages.clear();
-    this->messageIndexMap.clear();
+    this->messageIds.clear();
+    this->messageGroupings.clear();
     this->messagesToBeAdded.clear();
+    this->clearDeferredUpdates();
     this->chatId = chatInformation.value("id").toString();
-    tdLibWrapper->getChatHistory(this->chatId);
+    this->ownUserId = this->tdLibWrapper->getUserInformation().value("id").toString();
+    this->lastReadOutboxMessageId = chatInformation.value("last_read_outbox_message_id").toLongLong();
+    this->scrollAnchorMessageId.clear();
+    this->gapMessageIds.clear();
+    this->renderedTextCache.clear();
+    this->waveforms.clear();
+    this->pendingReplyMessageIds.clear();
+    this->requestedReplyMessageIds.clear();
+    this->replyPreviewTimer.stop();
+    this->viewedMessageIds.clear();
+    endResetModel();
+    this->inGapFill = false;
+    this->inIncrementalUpdate = false;
+    this->loadingNewerMessages = false;
+    this->hasNewerMessages = false;
+    this->messageWindowSize = qMax(this->tdLibWrapper->getMessageWindowSize(), MINIMUM_MESSAGE_WINDOW_SIZE);
+    this->lowestLoadedMessageId = 0;
+    this->highestLoadedMessageId = 0;
+    this->anchorMessageId = anchorMessageId;
+    this->inNetworkTopUp = false;
+    this->openTimer.start();
+    if (this->restoreChatState(anchorMessageId)) {
+        return;
+    }
+    qint64 numericAnchorMessageId = anchorMessageId.toLongLong();
+    if (numericAnchorMessageId == 0 || anchorMessageId == chatInformation.value("last_message").toMap().value("id").toString()) {
+        this->initialFromMessageId = 0;
+        this->initialOffset = 0;
+    } else {
+        // Loading around the anchor, the newest messages are fetched on demand when scrolling down
+        this->hasNewerMessages = true;
+        this->initialFromMessageId = numericAnchorMessageId;
+        this->initialOffset = - HISTORY_PAGE_SIZE / 2;
+    }
+    // What TDLib has in its message database is shown right away, the server is asked afterwards
+    this->networkTopUpPending = true;
+    this->requestChatHistory(this->initialFromMessageId, this->initialOffset, true);
 }
 
 void ChatModel::triggerLoadMoreHistory()
 {
-    if (!this->inIncrementalUpdate) {
+    if (!this->inIncrementalUpdate && !this->messageIds.isEmpty()) {
         qDebug() << "[ChatModel] Trigger loading older history...";
         this->inIncrementalUpdate = true;
-        this->tdLibWrapper->getChatHistory(this->chatId, this->messages.first().toMap().value("id").toLongLong());
+        this->loadingNewerMessages = false;
+        // Messages which were evicted before are still in TDLib's message database
+        // The page overlaps with what we have, so there can't be a gap in between
+        qint64 oldestMessageId = this->messageIds.first();
+        this->requestChatHistory(oldestMessageId, -1, oldestMessageId > this->lowestLoadedMessageId);
+    }
+}
+
+void ChatModel::triggerLoadMoreFuture()
+{
+    if (!this->inIncrementalUpdate && this->hasNewerMessages && !this->messageIds.isEmpty()) {
+        qDebug() << "[ChatModel] Trigger loading newer history...";
+        this->inIncrementalUpdate = true;
+        this->loadingNewerMessages = true;
+        // A negative offset returns messages newer than the given one, which is part of the result itself
+        this->requestChatHistory(this->messageIds.last(), 1 - HISTORY_PAGE_SIZE, true);
+    }
+}
+
+void ChatModel::setScrollAnchor(const QString &messageId)
+{
+    this->scrollAnchorMessageId = messageId;
+}
+
+void ChatModel::reportVisibleRange(const int &firstRow, const int &lastRow)
+{
+    // Views report what they show, the model knows what was reported already
+    if (lastRow < 0 || lastRow >= this->messages.size()) {
+        return;
+    }
+    qint64 lastReadInboxMessageId = this->chatInformation.value("last_read_inbox_message_id").toLongLong();
+    // The top edge may be in the spacing between two messages, the bottom one is visible in any case
+    for (int i = (firstRow < 0) ? lastRow : firstRow; i <= lastRow; i++) {
+        qint64 messageId = this->messageIds.at(i);
+        if (messageId <= lastReadInboxMessageId || this->viewedMessageIds.contains(messageId)) {
+            continue;
+        }
+        // TDLib rejects the whole request if it contains an ID it doesn't know, like the ones of the outbox
+        if (messageId >= MessageOutbox::FIRST_LOCAL_MESSAGE_ID || this->messages.at(i).toMap().value("is_outgoing").toBool()) {
+            continue;
+        }
+        this->viewedMessageIds.insert(messageId);
+        this->pendingViewedMessageIds.append(messageId);
+    }
+    if (!this->pendingViewedMessageIds.isEmpty() && !this->viewMessagesTimer.isActive()) {
+        this->viewMessagesTimer.start();
     }
 }
 
@@ -117,48 +320,101 @@ void ChatModel::handleMessagesReceived(const QVariantList &messages)
 {
     qDebug() << "[ChatModel] Receiving new messages :)" << messages.size();
 
+    // Pages overlap with what we have, only a page without any unknown message means there's nothing stored locally
+    bool unknownMessagesReceived = false;
+    QListIterator<QVariant> receivedMessagesIterator(messages);
+    while (!unknownMessagesReceived && receivedMessagesIterator.hasNext()) {
+        unknownMessagesReceived = this->indexOfMessage(receivedMessagesIterator.next().toMap().value("id").toString()) == -1;
+    }
+    if (!unknownMessagesReceived && this->inLocalHistoryRequest) {
+        qDebug() << "[ChatModel] Messages not available locally, asking the server...";
+        if (!this->inIncrementalUpdate) {
+            this->networkTopUpPending = false;
+        }
+        this->requestChatHistory(this->historyRequestFromMessageId, this->historyRequestOffset, false);
+        return;
+    }
+    this->inLocalHistoryRequest = false;
+
     if (messages.size() == 0) {
         qDebug() << "[ChatModel] No additional messages loaded, notifying chat UI...";
         this->inReload = false;
-        int listInboxPosition = this->calculateLastKnownMessageId();
-        int listOutboxPosition = this->calculateLastReadSentMessageId();
-        if (this->inIncrementalUpdate) {
-            this->inIncrementalUpdate = false;
-            emit messagesIncrementalUpdate(listInboxPosition, listOutboxPosition);
-        } else {
-            emit messagesReceived(listInboxPosition, listOutboxPosition);
+        if (this->loadingNewerMessages) {
+            this->hasNewerMessages = false;
         }
+        this->notifyHistoryLoaded();
     } else {
         this->messagesMutex.lock();
         this->messagesToBeAdded.clear();
+        qint64 batchFirstMessageId = 0;
+        qint64 batchLastMessageId = 0;
         QListIterator<QVariant> messagesIterator(messages);
         while (messagesIterator.hasNext()) {
             QVariantMap currentMessage = messagesIterator.next().toMap();
-            if (currentMessage.value("chat_id").toString() == this->chatId) {
+            if (currentMessage.value("chat_id").toString() != this->chatId) {
+                continue;
+            }
+            qint64 currentMessageId = currentMessage.value("id").toLongLong();
+            if (batchFirstMessageId == 0 || currentMessageId < batchFirstMessageId) {
+                batchFirstMessageId = currentMessageId;
+            }
+            if (currentMessageId > batchLastMessageId) {
+                batchLastMessageId = currentMessageId;
+            }
+            // Pages may overlap with what we already have, e.g. the message we started from
+            if (this->indexOfMessage(currentMessage.value("id").toString()) == -1) {
                 this->messagesToBeAdded.append(currentMessage);
             }
         }
         std::sort(this->messagesToBeAdded.begin(), this->messagesToBeAdded.end(), compareMessages);
+        if (batchLastMessageId != 0) {
+            this->updateGapMarkers(batchFirstMessageId, batchLastMessageId);
+        }
+        if (this->inGapFill && this->messagesToBeAdded.isEmpty()) {
+            qDebug() << "[ChatModel] Nothing found in gap after message" << this->gapFillMessageId;
+            this->gapMessageIds.remove(this->gapFillMessageId);
+        }
 
-        this->insertMessages();
+        if (!this->messagesToBeAdded.isEmpty()) {
+            qint64 firstAddedMessageId = this->messagesToBeAdded.first().toMap().value("id").toLongLong();
+            qint64 lastAddedMessageId = this->messagesToBeAdded.last().toMap().value("id").toLongLong();
+            if (this->lowestLoadedMessageId == 0 || firstAddedMessageId < this->lowestLoadedMessageId) {
+                this->lowestLoadedMessageId = firstAddedMessageId;
+            }
+            if (lastAddedMessageId > this->highestLoadedMessageId) {
+                this->highestLoadedMessageId = lastAddedMessageId;
+            }
+            qint64 newestMessageId = this->chatInformation.value("last_message").toMap().value("id").toLongLong();
+            if (this->hasNewerMessages && newestMessageId != 0 && lastAddedMessageId >= newestMessageId) {
+                qDebug() << "[ChatModel] Reached the newest message of this chat";
+                this->hasNewerMessages = false;
+            }
+            // Unsent messages have the highest IDs, they belong after the newest messages only
+            if (!this->hasNewerMessages) {
+                QListIterator<QVariant> outboxMessagesIterator(this->tdLibWrapper->getOutboxMessages(this->chatId));
+                while (outboxMessagesIterator.hasNext()) {
+                    QVariant outboxMessage = outboxMessagesIterator.next();
+                    if (this->indexOfMessage(outboxMessage.toMap().value("id").toString()) == -1) {
+                        this->messagesToBeAdded.append(outboxMessage);
+                    }
+                }
+            }
+            this->insertMessages();
+            this->evictMessages();
+        } else if (this->loadingNewerMessages) {
+            this->hasNewerMessages = false;
+        }
         this->messagesMutex.unlock();
 
         // First call only returns a few messages, we need to get a little more than that...
-        if (this->messagesToBeAdded.size() < 10 && !this->inReload) {
+        if (!this->messagesToBeAdded.isEmpty() && this->messagesToBeAdded.size() < 10 && !this->inReload && !this->loadingNewerMessages && !this->inNetworkTopUp && !this->inGapFill) {
             qDebug() << "[ChatModel] Only a few messages received in first call, loading more...";
             this->inReload = true;
-            this->tdLibWrapper->getChatHistory(this->chatId, this->messagesToBeAdded.first().toMap().value("id").toLongLong());
+            this->requestChatHistory(this->messageIds.first(), -1, false);
         } else {
             qDebug() << "[ChatModel] Messages loaded, notifying chat UI...";
             this->inReload = false;
-            int listInboxPosition = this->calculateLastKnownMessageId();
-            int listOutboxPosition = this->calculateLastReadSentMessageId();
-            if (this->inIncrementalUpdate) {
-                this->inIncrementalUpdate = false;
-                emit messagesIncrementalUpdate(listInboxPosition, listOutboxPosition);
-            } else {
-                emit messagesReceived(listInboxPosition, listOutboxPosition);
-            }
+            this->notifyHistoryLoaded();
         }
     }
 
@@ -168,6 +424,16 @@ void ChatModel::handleNewMessageReceived(const QString &chatId, const QVariantMa
 {
     if (chatId == this->chatId) {
         qDebug() << "[ChatModel] New message received for this chat";
+        // What the user just wrote is shown in any case, it stays after the loaded messages until the newest ones are there
+        bool outboxMessage = message.value("id").toLongLong() >= MessageOutbox::FIRST_LOCAL_MESSAGE_ID;
+        if (this->hasNewerMessages && !outboxMessage) {
+            qDebug() << "[ChatModel] Newest messages are not loaded, message will be fetched when scrolling there";
+            return;
+        }
+        if (this->deferredUpdates) {
+            this->deferredMessages.append(message);
+            return;
+        }
         this->messagesMutex.lock();
 
         this->messagesToBeAdded.clear();
@@ -176,6 +442,8 @@ void ChatModel::handleNewMessageReceived(const QString &chatId, const QVariantMa
         this->insertMessages();
         this->messagesMutex.unlock();
         emit newMessageReceived();
+    } else {
+        this->updateCachedChatState(chatId, message, QString());
     }
 }
 
@@ -185,6 +453,10 @@ void ChatModel::handleChatReadInboxUpdated(const QString &chatId, const QString
         qDebug() << "[ChatModel] Updating chat unread count, unread messages " << unreadCount << ", last read message ID: " << lastReadInboxMessageId;
         this->chatInformation.insert("unread_count", unreadCount);
         this->chatInformation.insert("last_read_inbox_message_id", lastReadInboxMessageId);
+        if (this->deferredUpdates) {
+            this->deferredReadInboxUpdate = true;
+            return;
+        }
         emit unreadCountUpdated(unreadCount, lastReadInboxMessageId);
     }
 }
@@ -193,25 +465,54 @@ void ChatModel::handleChatReadOutboxUpdated(const QString &chatId, const QString
 {
     if (chatId == this->chatId) {
         this->chatInformation.insert("last_read_outbox_message_id", lastReadOutboxMessageId);
-        int sentIndex = calculateLastReadSentMessageId();
-        qDebug() << "[ChatModel] Updating sent message ID, new index " << sentIndex;
-        emit lastReadSentMessageUpdated(sentIndex);
+        if (this->deferredUpdates) {
+            this->deferredReadOutboxUpdate = true;
+            return;
+        }
+        this->updateLastReadOutboxMessage(lastReadOutboxMessageId.toLongLong());
     }
 }
 
 void ChatModel::handleMessageSendSucceeded(const QString &messageId, const QString &oldMessageId, const QVariantMap &message)
 {
     qDebug() << "[ChatModel] Message send succeeded, new message ID " << messageId << "old message ID " << oldMessageId << ", chat ID" << message.value("chat_id").toString();
-    qDebug() << "[ChatModel] index map: " << this->messageIndexMap.contains(oldMessageId) << ", index count: " << this->messageIndexMap.size() << ", message count: " << this->messages.size();
-    if (this->messageIndexMap.contains(oldMessageId)) {
+    this->replaceMessage(messageId, oldMessageId, message);
+}
+
+void ChatModel::handleMessageSendFailed(const QString &messageId, const QString &oldMessageId, const QVariantMap &message)
+{
+    qDebug() << "[ChatModel] Message send failed, new message ID " << messageId << "old message ID " << oldMessageId << ", chat ID" << message.value("chat_id").toString();
+    this->replaceMessage(messageId, oldMessageId, message);
+}
+
+void ChatModel::replaceMessage(const QString &messageId, const QString &oldMessageId, const QVariantMap &message)
+{
+    if (message.value("chat_id").toString() != this->chatId) {
+        this->updateCachedChatState(message.value("chat_id").toString(), message, oldMessageId);
+        return;
+    }
+    int deferredMessageIndex = this->indexOfDeferredMessage(oldMessageId);
+    if (deferredMessageIndex != -1) {
+        this->deferredMessages.replace(deferredMessageIndex, message);
+        return;
+    }
+    int messageIndex = this->indexOfMessage(oldMessageId);
+    if (messageIndex != -1) {
         this->messagesMutex.lock();
-        qDebug() << "[ChatModel] Message was successfully sent " << oldMessageId;
-        int messageIndex = this->messageIndexMap.value(oldMessageId).toInt();
         this->messages.replace(messageIndex, message);
-        this->calculateMessageIndexMap();
+        this->messageIds.replace(messageIndex, message.value("id").toLongLong());
+        this->renderedTextCache.remove(oldMessageId);
+        this->moveReplacedMessage(messageIndex);
+        messageIndex = this->indexOfMessage(messageId);
+        // The date assigned by the server may differ from the local one
+        this->updateMessageGrouping(messageIndex);
+        this->updateAdjacentGroupings(messageIndex, messageIndex);
         qDebug() << "[ChatModel] Message was replaced at index " << messageIndex;
         this->messagesMutex.unlock();
-        emit lastReadSentMessageUpdated(calculateLastReadSentMessageId());
+        if (this->deferredUpdates) {
+            this->deferredChangedMessageIds.insert(messageId);
+            return;
+        }
         emit dataChanged(index(messageIndex), index(messageIndex));
     }
 }
@@ -228,41 +529,179 @@ void ChatModel::handleChatNotificationSettingsUpdated(const QString &chatId, con
 void ChatModel::handleMessageContentUpdated(const QString &chatId, const QString &messageId, const QVariantMap &newContent)
 {
     qDebug() << "[ChatModel] Message content updated" << chatId << messageId;
-    if (chatId == this->chatId && this->messageIndexMap.contains(messageId)) {
-        this->messagesMutex.lock();
-        qDebug() << "[ChatModel] We know the message that was updated " << messageId;
-        int messageIndex = this->messageIndexMap.value(messageId).toInt();
-        QVariantMap messageToBeUpdated = this->messages.at(messageIndex).toMap();
-        messageToBeUpdated.insert("content", newContent);
-        this->messages.replace(messageIndex, messageToBeUpdated);
-        this->calculateMessageIndexMap();
-        qDebug() << "[ChatModel] Message was replaced at index " << messageIndex;
-        this->messagesMutex.unlock();
-        emit messageUpdated(messageIndex);
-        emit dataChanged(index(messageIndex), index(messageIndex));
-    }
+    QVector<int> changedRoles;
+    changedRoles.append(Qt::DisplayRole);
+    changedRoles.append(MessageTextRole);
+    changedRoles.append(ContentTypeRole);
+    this->updateMessage(chatId, messageId, "content", newContent, changedRoles);
+}
+
+void ChatModel::handleMessageEdited(const QString &chatId, const QString &messageId, const int &editDate)
+{
+    qDebug() << "[ChatModel] Message edited" << chatId << messageId;
+    QVector<int> changedRoles;
+    changedRoles.append(EditedRole);
+    this->updateMessage(chatId, messageId, "edit_date", editDate, changedRoles);
+}
+
+void ChatModel::handleMessageViewsUpdated(const QString &chatId, const QString &messageId, const int &views)
+{
+    QVector<int> changedRoles;
+    changedRoles.append(ViewCountRole);
+    this->updateMessage(chatId, messageId, "views", views, changedRoles);
 }
 
 void ChatModel::handleMessagesDeleted(const QString &chatId, const QVariantList &messageIds)
 {
     qDebug() << "[ChatModel] Messages were deleted in a chat" << chatId;
     if (chatId == this->chatId) {
-        this->messagesMutex.lock();
         qDebug() << "[ChatModel] Messages in this chat were deleted...";
-        QListIterator<QVariant> messageIdIterator(messageIds);
-        while (messageIdIterator.hasNext()) {
-            QString messageId = messageIdIterator.next().toString();
-            if (this->messageIndexMap.contains(messageId)) {
-                int messageIndex = this->messageIndexMap.value(messageId).toInt();
-                beginRemoveRows(QModelIndex(), messageIndex, messageIndex);
-                qDebug() << "[ChatModel] ...and we even know this message!" << messageId << messageIndex;
-                this->messages.removeAt(messageIndex);
-                this->calculateMessageIndexMap();
-                endRemoveRows();
+        if (this->deferredUpdates) {
+            QListIterator<QVariant> messageIdIterator(messageIds);
+            while (messageIdIterator.hasNext()) {
+                QVariant messageId = messageIdIterator.next();
+                int deferredMessageIndex = this->indexOfDeferredMessage(messageId.toString());
+                if (deferredMessageIndex != -1) {
+                    this->deferredMessages.removeAt(deferredMessageIndex);
+                } else {
+                    this->deferredDeletedMessageIds.append(messageId);
+                }
             }
+            return;
         }
+        this->messagesMutex.lock();
+        this->removeMessages(messageIds);
         this->messagesMutex.unlock();
         emit messagesDeleted();
+    } else {
+        this->removeFromCachedChatState(chatId, messageIds);
+    }
+}
+
+void ChatModel::handleMinuteChanged()
+{
+    // Only the elapsed time is outdated, views just refresh the delegates they currently have
+    if (this->messages.isEmpty()) {
+        return;
+    }
+    QVector<int> changedRoles;
+    changedRoles.append(MessageElapsedRole);
+    emit dataChanged(this->index(0), this->index(this->messages.size() - 1), changedRoles);
+}
+
+void ChatModel::handleUserUpdated(const QString &userId, const QVariantMap &userInformation)
+{
+    // Only senders which were already shown are of interest, and only if their name or picture changed
+    QHash<QString, SenderInformation>::iterator sender = this->senders.find(userId);
+    if (sender == this->senders.end()) {
+        return;
+    }
+    SenderInformation updatedSender = this->createSender(userInformation);
+    if (sender.value().name == updatedSender.name && sender.value().photo == updatedSender.photo) {
+        return;
+    }
+    qDebug() << "[ChatModel] Sender information changed" << userId;
+    sender.value() = updatedSender;
+    QVector<int> changedRoles;
+    changedRoles.append(SenderNameRole);
+    changedRoles.append(SenderPhotoRole);
+    int rangeStart = -1;
+    for (int i = 0; i <= this->messages.size(); i++) {
+        bool sentByUser = (i < this->messages.size()) && this->messages.at(i).toMap().value("sender_user_id").toString() == userId;
+        if (sentByUser && this->deferredUpdates) {
+            this->deferredChangedMessageIds.insert(QString::number(this->messageIds.at(i)));
+        } else if (sentByUser && rangeStart == -1) {
+            rangeStart = i;
+        } else if (!sentByUser && rangeStart != -1) {
+            emit dataChanged(this->index(rangeStart), this->index(i - 1), changedRoles);
+            rangeStart = -1;
+        }
+    }
+}
+
+void ChatModel::handleMessagesFetched(const QString &chatId, const QVariantList &messageIds, const QVariantList &messages)
+{
+    if (chatId != this->chatId) {
+        return;
+    }
+    // Messages which don't exist anymore are answered with null, so results are matched by position
+    QSet<qint64> resolvedMessageIds;
+    for (int i = 0; i < messageIds.size(); i++) {
+        QString messageId = messageIds.at(i).toString();
+        if (!this->requestedReplyMessageIds.remove(messageId)) {
+            continue;
+        }
+        QVariantMap repliedMessage = (i < messages.size()) ? messages.at(i).toMap() : QVariantMap();
+        this->replyPreviews.insert(chatId + ":" + messageId, new QVariantMap(this->createReplyPreview(repliedMessage)));
+        resolvedMessageIds.insert(messageId.toLongLong());
+    }
+    qDebug() << "[ChatModel] Resolved" << resolvedMessageIds.size() << "replied messages";
+    QVector<int> changedRoles;
+    changedRoles.append(ReplyPreviewRole);
+    for (int i = 0; i < this->messages.size(); i++) {
+        if (resolvedMessageIds.contains(this->messages.at(i).toMap().value("reply_to_message_id").toLongLong())) {
+            emit dataChanged(this->index(i), this->index(i), changedRoles);
+        }
+    }
+}
+
+void ChatModel::requestReplyPreviews()
+{
+    // Delegates ask one after another while the view is filled, so their lookups end up in one request
+    QVariantList messageIds;
+    QSetIterator<QString> pendingIterator(this->pendingReplyMessageIds);
+    while (pendingIterator.hasNext()) {
+        QString messageId = pendingIterator.next();
+        this->requestedReplyMessageIds.insert(messageId);
+        messageIds.append(messageId.toLongLong());
+    }
+    this->pendingReplyMessageIds.clear();
+    if (!messageIds.isEmpty()) {
+        this->tdLibWrapper->getMessages(this->chatId, messageIds);
+    }
+}
+
+void ChatModel::flushViewedMessages()
+{
+    // At most one request per interval, containing everything seen in the meantime
+    this->viewMessagesTimer.stop();
+    if (this->pendingViewedMessageIds.isEmpty()) {
+        return;
+    }
+    qDebug() << "[ChatModel] Reporting" << this->pendingViewedMessageIds.size() << "viewed messages";
+    this->tdLibWrapper->viewMessages(this->chatId, this->pendingViewedMessageIds);
+    this->pendingViewedMessageIds.clear();
+}
+
+void ChatModel::handleFontSizesChanged()
+{
+    this->renderedTextCache.clear();
+    this->senders.clear();
+    this->replyPreviews.clear();
+    if (this->messages.isEmpty()) {
+        return;
+    }
+    QVector<int> changedRoles;
+    changedRoles.append(MessageTextRole);
+    changedRoles.append(SenderNameRole);
+    changedRoles.append(ReplyPreviewRole);
+    emit dataChanged(this->index(0), this->index(this->messages.size() - 1), changedRoles);
+}
+
+void ChatModel::handleApplicationStateChanged(Qt::ApplicationState applicationState)
+{
+    if (applicationState == Qt::ApplicationActive) {
+        if (this->deferredUpdates) {
+            this->deferredUpdates = false;
+            this->applyDeferredUpdates();
+        }
+    } else {
+        // The app may not come back, what has been read so far is reported right away
+        this->flushViewedMessages();
+        if (!this->deferredUpdates) {
+            qDebug() << "[ChatModel] Application not active, deferring UI updates";
+            this->deferredUpdates = true;
+        }
     }
 }
 
@@ -271,49 +710,458 @@ void ChatModel::insertMessages()
     if (this->messages.isEmpty()) {
         beginResetModel();
         this->messages.append(this->messagesToBeAdded);
-        this->calculateMessageIndexMap();
+        QListIterator<QVariant> messagesIterator(this->messagesToBeAdded);
+        while (messagesIterator.hasNext()) {
+            this->messageIds.append(messagesIterator.next().toMap().value("id").toLongLong());
+        }
+        this->rebuildMessageGroupings();
         endResetModel();
     } else {
-        // There is only an append or a prepend, tertium non datur! (probably ;))
-        if (this->messages.last().toMap().value("id").toLongLong() < this->messagesToBeAdded.first().toMap().value("id").toLongLong()) {
-            // Append
-            this->insertRows(rowCount(QModelIndex()), this->messagesToBeAdded.size());
-        } else {
-            // Prepend
-            this->insertRows(0, this->messagesToBeAdded.size());
+        // Sorted merge, messages which belong to the same position are inserted together
+        QVariantList messagesToBeMerged = this->messagesToBeAdded;
+        int blockStart = 0;
+        while (blockStart < messagesToBeMerged.size()) {
+            qint64 blockStartMessageId = messagesToBeMerged.at(blockStart).toMap().value("id").toLongLong();
+            int insertionIndex = static_cast<int>(std::lower_bound(this->messageIds.constBegin(), this->messageIds.constEnd(), blockStartMessageId) - this->messageIds.constBegin());
+            if (insertionIndex < this->messageIds.size() && this->messageIds.at(insertionIndex) == blockStartMessageId) {
+                qDebug() << "[ChatModel] Skipping already known message" << blockStartMessageId;
+                blockStart++;
+                continue;
+            }
+            int blockEnd = blockStart;
+            while (blockEnd + 1 < messagesToBeMerged.size()
+                   && (insertionIndex == this->messageIds.size() || messagesToBeMerged.at(blockEnd + 1).toMap().value("id").toLongLong() < this->messageIds.at(insertionIndex))) {
+                blockEnd++;
+            }
+            this->messagesToBeAdded = messagesToBeMerged.mid(blockStart, blockEnd - blockStart + 1);
+            this->insertRows(insertionIndex, this->messagesToBeAdded.size());
+            blockStart = blockEnd + 1;
         }
+        this->messagesToBeAdded = messagesToBeMerged;
     }
 }
 
-QVariantMap ChatModel::enhanceMessage(const QVariantMap &message)
+void ChatModel::removeMessages(const QVariantList &messageIds)
 {
-    QVariantMap enhancedMessage = message;
-    if (enhancedMessage.value("content").toMap().value("@type").toString() == "messageVoiceNote" ) {
-        QVariantMap contentMap = enhancedMessage.value("content").toMap();
-        QVariantMap voiceNoteMap = contentMap.value("voice_note").toMap();
-        QByteArray waveBytes = QByteArray::fromBase64(voiceNoteMap.value("waveform").toByteArray());
-        QBitArray waveBits(waveBytes.count() * 8);
+    QList<int> messageIndexes;
+    QListIterator<QVariant> messageIdIterator(messageIds);
+    while (messageIdIterator.hasNext()) {
+        int messageIndex = this->indexOfMessage(messageIdIterator.next().toString());
+        if (messageIndex != -1) {
+            messageIndexes.append(messageIndex);
+        }
+    }
+    qDebug() << "[ChatModel] ...and we even know" << messageIndexes.size() << "of these messages!";
+    std::sort(messageIndexes.begin(), messageIndexes.end());
 
-        for (int i = 0; i < waveBytes.count(); i++) {
-            for (int b = 0; b < 8; b++) {
-                waveBits.setBit( i * 8 + b, waveBytes.at(i) & (1 << (7 - b)) );
-            }
+    // Contiguous rows go away in one step, starting at the end so that lower row numbers stay valid
+    int rangeEnd = messageIndexes.size() - 1;
+    while (rangeEnd >= 0) {
+        int rangeStart = rangeEnd;
+        while (rangeStart > 0 && messageIndexes.at(rangeStart - 1) >= messageIndexes.at(rangeStart) - 1) {
+            rangeStart--;
+        }
+        // A possible gap after the last removed message now follows the message before the range
+        int firstRow = messageIndexes.at(rangeStart);
+        if (firstRow > 0 && this->gapMessageIds.contains(this->messageIds.at(messageIndexes.at(rangeEnd)))) {
+            this->gapMessageIds.insert(this->messageIds.at(firstRow - 1));
         }
-        int waveSize = 10;
-        int waveformSets = waveBits.size() / waveSize;
-        QVariantList decodedWaveform;
-        for (int i = 0; i < waveformSets; i++) {
-            int waveformHeight = 0;
-            for (int j = 0; j < waveSize; j++) {
-                waveformHeight = waveformHeight + ( waveBits.at(i * waveSize + j) * (2 ^ (j)) );
+        this->removeMessageRange(firstRow, messageIndexes.at(rangeEnd));
+        rangeEnd = rangeStart - 1;
+    }
+}
+
+void ChatModel::removeMessageRange(const int &firstRow, const int &lastRow)
+{
+    qDebug() << "[ChatModel] Removing rows" << firstRow << "to" << lastRow;
+    for (int i = firstRow; i <= lastRow; i++) {
+        this->gapMessageIds.remove(this->messageIds.at(i));
+        this->renderedTextCache.remove(QString::number(this->messageIds.at(i)));
+    }
+    beginRemoveRows(QModelIndex(), firstRow, lastRow);
+    this->messages.erase(this->messages.begin() + firstRow, this->messages.begin() + lastRow + 1);
+    this->messageIds.erase(this->messageIds.begin() + firstRow, this->messageIds.begin() + lastRow + 1);
+    this->messageGroupings.remove(firstRow, lastRow - firstRow + 1);
+    endRemoveRows();
+    this->updateAdjacentGroupings(firstRow, firstRow - 1);
+}
+
+void ChatModel::updateMessage(const QString &chatId, const QString &messageId, const QString &fieldName, const QVariant &fieldValue, const QVector<int> &changedRoles)
+{
+    // A changed field reaches the view as a change of the roles depending on it, just for this one row
+    if (chatId != this->chatId) {
+        if (this->chatStateCache.contains(chatId)) {
+            const ChatState &cachedChatState = this->chatStateCache[chatId];
+            int cachedMessageIndex = indexOfMessageId(cachedChatState.messageIds, messageId);
+            if (cachedMessageIndex != -1) {
+                QVariantMap cachedMessage = cachedChatState.messages.at(cachedMessageIndex).toMap();
+                cachedMessage.insert(fieldName, fieldValue);
+                this->updateCachedChatState(chatId, cachedMessage, messageId);
             }
-            decodedWaveform.append(waveformHeight);
         }
-        voiceNoteMap.insert("decoded_voice_note", decodedWaveform);
-        contentMap.insert("voice_note", voiceNoteMap);
-        enhancedMessage.insert("content", contentMap);
+        return;
+    }
+    int deferredMessageIndex = this->indexOfDeferredMessage(messageId);
+    if (deferredMessageIndex != -1) {
+        QVariantMap deferredMessage = this->deferredMessages.at(deferredMessageIndex).toMap();
+        deferredMessage.insert(fieldName, fieldValue);
+        this->deferredMessages.replace(deferredMessageIndex, deferredMessage);
+        return;
+    }
+    int messageIndex = this->indexOfMessage(messageId);
+    if (messageIndex == -1) {
+        return;
+    }
+    this->messagesMutex.lock();
+    QVariantMap messageToBeUpdated = this->messages.at(messageIndex).toMap();
+    messageToBeUpdated.insert(fieldName, fieldValue);
+    this->messages.replace(messageIndex, messageToBeUpdated);
+    if (changedRoles.contains(MessageTextRole)) {
+        this->renderedTextCache.remove(messageId);
+        this->replyPreviews.remove(chatId + ":" + messageId);
+    }
+    this->messagesMutex.unlock();
+    if (this->deferredUpdates) {
+        this->deferredChangedMessageIds.insert(messageId);
+        return;
+    }
+    emit dataChanged(this->index(messageIndex), this->index(messageIndex), changedRoles);
+}
+
+void ChatModel::evictMessages()
+{
+    // Only pages loaded by scrolling move the window, the messages on the far side of it are dropped
+    // Gap fills and the server's answer when opening a chat add to what is shown, they don't move the viewport
+    if (!this->inIncrementalUpdate || this->inGapFill || this->inNetworkTopUp) {
+        return;
+    }
+    int excessMessages = this->messages.size() - this->messageWindowSize;
+    if (excessMessages <= 0) {
+        return;
+    }
+    if (this->loadingNewerMessages) {
+        qDebug() << "[ChatModel] Evicting" << excessMessages << "older messages";
+        this->removeMessageRange(0, excessMessages - 1);
+    } else {
+        qDebug() << "[ChatModel] Evicting" << excessMessages << "newer messages";
+        this->removeMessageRange(this->messages.size() - excessMessages, this->messages.size() - 1);
+        this->hasNewerMessages = true;
+    }
+}
+
+void ChatModel::rebuildMessageGroupings()
+{
+    this->messageGroupings.fill(MessageGrouping(), this->messages.size());
+    for (int i = 0; i < this->messages.size(); i++) {
+        this->updateMessageGrouping(i);
+    }
+}
+
+bool ChatModel::updateMessageGrouping(const int &row)
+{
+    // Depends on the direct neighbours only, the album index is continued from the row before
+    QVariantMap message = this->messages.at(row).toMap();
+    QVariantMap previousMessage = (row > 0) ? this->messages.at(row - 1).toMap() : QVariantMap();
+    QVariantMap nextMessage = (row + 1 < this->messages.size()) ? this->messages.at(row + 1).toMap() : QVariantMap();
+    QDate messageDate = QDateTime::fromMSecsSinceEpoch(message.value("date").toLongLong() * 1000).date();
+    bool sameDayAsPrevious = !previousMessage.isEmpty() && QDateTime::fromMSecsSinceEpoch(previousMessage.value("date").toLongLong() * 1000).date() == messageDate;
+    bool sameDayAsNext = !nextMessage.isEmpty() && QDateTime::fromMSecsSinceEpoch(nextMessage.value("date").toLongLong() * 1000).date() == messageDate;
+    QString senderUserId = message.value("sender_user_id").toString();
+    qint64 albumId = message.value("media_album_id").toLongLong();
+
+    MessageGrouping messageGrouping;
+    messageGrouping.dayBoundary = !sameDayAsPrevious;
+    messageGrouping.firstInRun = !sameDayAsPrevious || previousMessage.value("sender_user_id").toString() != senderUserId;
+    messageGrouping.lastInRun = !sameDayAsNext || nextMessage.value("sender_user_id").toString() != senderUserId;
+    if (albumId == 0) {
+        messageGrouping.albumIndex = -1;
+    } else if (previousMessage.value("media_album_id").toLongLong() == albumId) {
+        messageGrouping.albumIndex = this->messageGroupings.at(row - 1).albumIndex + 1;
+    } else {
+        messageGrouping.albumIndex = 0;
+    }
+
+    MessageGrouping &currentGrouping = this->messageGroupings[row];
+    bool changed = currentGrouping.firstInRun != messageGrouping.firstInRun
+            || currentGrouping.lastInRun != messageGrouping.lastInRun
+            || currentGrouping.albumIndex != messageGrouping.albumIndex
+            || currentGrouping.dayBoundary != messageGrouping.dayBoundary;
+    currentGrouping = messageGrouping;
+    return changed;
+}
+
+void ChatModel::updateAdjacentGroupings(const int &firstRow, const int &lastRow)
+{
+    // Rows between firstRow and lastRow were changed, only the rows next to them may be affected
+    QVector<int> changedRoles;
+    changedRoles.append(FirstInRunRole);
+    changedRoles.append(LastInRunRole);
+    changedRoles.append(AlbumIndexRole);
+    changedRoles.append(DayBoundaryRole);
+    int previousRow = firstRow - 1;
+    if (previousRow >= 0 && previousRow < this->messages.size() && this->updateMessageGrouping(previousRow)) {
+        emit dataChanged(this->index(previousRow), this->index(previousRow), changedRoles);
+    }
+    // Album indexes carry on, so changes may run on until the end of an album
+    for (int row = qMax(lastRow + 1, 0); row < this->messages.size(); row++) {
+        if (!this->updateMessageGrouping(row)) {
+            break;
+        }
+        emit dataChanged(this->index(row), this->index(row), changedRoles);
+    }
+}
+
+void ChatModel::requestChatHistory(const qint64 &fromMessageId, const int &offset, const bool &onlyLocal)
+{
+    this->inLocalHistoryRequest = onlyLocal;
+    this->historyRequestFromMessageId = fromMessageId;
+    this->historyRequestOffset = offset;
+    this->tdLibWrapper->getChatHistory(this->chatId, fromMessageId, offset, HISTORY_PAGE_SIZE, onlyLocal);
+}
+
+void ChatModel::notifyHistoryLoaded()
+{
+    if (this->inGapFill) {
+        this->inGapFill = false;
+        this->inIncrementalUpdate = false;
+    } else if (this->inNetworkTopUp) {
+        qDebug() << "[ChatModel] Messages from the server merged after" << this->openTimer.elapsed() << "ms";
+        this->inNetworkTopUp = false;
+        this->inIncrementalUpdate = false;
+    } else if (this->loadingNewerMessages) {
+        // The view stays where it is when newer messages are appended
+        this->loadingNewerMessages = false;
+        this->inIncrementalUpdate = false;
+    } else if (this->inIncrementalUpdate) {
+        this->inIncrementalUpdate = false;
+        emit messagesIncrementalUpdate(this->calculateLastKnownMessageId());
+    } else {
+        // Initially the view is placed at the message the chat was opened at
+        int anchorPosition = this->indexOfMessage(this->anchorMessageId);
+        emit messagesReceived((anchorPosition == -1) ? this->calculateLastKnownMessageId() : anchorPosition);
+        qDebug() << "[ChatModel] First messages of chat" << this->chatId << "available after" << this->openTimer.elapsed() << "ms, from local database:" << this->networkTopUpPending;
+        if (this->networkTopUpPending) {
+            // Scrolling doesn't load anything else until the server's answer has been merged
+            this->networkTopUpPending = false;
+            this->inNetworkTopUp = true;
+            this->inIncrementalUpdate = true;
+            this->requestChatHistory(this->initialFromMessageId, this->initialOffset, false);
+        }
+    }
+    this->fillNextGap();
+}
+
+void ChatModel::updateGapMarkers(const qint64 &batchFirstMessageId, const qint64 &batchLastMessageId)
+{
+    // A batch from TDLib is contiguous, gaps can only remain where it touches messages we had before
+    if (this->messageIds.isEmpty()) {
+        return;
+    }
+    int firstIndexAfterBatch = static_cast<int>(std::upper_bound(this->messageIds.constBegin(), this->messageIds.constEnd(), batchLastMessageId) - this->messageIds.constBegin());
+    bool gapAfterBatch = false;
+    if (firstIndexAfterBatch < this->messageIds.size()) {
+        gapAfterBatch = (firstIndexAfterBatch == 0) || this->gapMessageIds.contains(this->messageIds.at(firstIndexAfterBatch - 1));
+    }
+    int firstIndexOfBatch = static_cast<int>(std::lower_bound(this->messageIds.constBegin(), this->messageIds.constEnd(), batchFirstMessageId) - this->messageIds.constBegin());
+    if (firstIndexOfBatch == this->messageIds.size()) {
+        this->gapMessageIds.insert(this->messageIds.last());
+    }
+    QMutableSetIterator<qint64> gapIterator(this->gapMessageIds);
+    while (gapIterator.hasNext()) {
+        qint64 gapMessageId = gapIterator.next();
+        if (gapMessageId >= batchFirstMessageId && gapMessageId <= batchLastMessageId) {
+            gapIterator.remove();
+        }
+    }
+    if (gapAfterBatch) {
+        this->gapMessageIds.insert(batchLastMessageId);
+    }
+    if (!this->gapMessageIds.isEmpty()) {
+        qDebug() << "[ChatModel] Possible gaps after messages" << this->gapMessageIds;
+    }
+}
+
+void ChatModel::fillNextGap()
+{
+    if (this->inIncrementalUpdate || this->gapMessageIds.isEmpty()) {
+        return;
+    }
+    // The newest gap comes first, it's closest to what is usually looked at
+    qint64 gapMessageId = *std::max_element(this->gapMessageIds.constBegin(), this->gapMessageIds.constEnd());
+    int gapMessageIndex = this->indexOfMessage(QString::number(gapMessageId));
+    if (gapMessageIndex == -1 || gapMessageIndex + 1 >= this->messageIds.size()) {
+        this->gapMessageIds.remove(gapMessageId);
+        this->fillNextGap();
+        return;
+    }
+    qDebug() << "[ChatModel] Filling gap between messages" << gapMessageId << "and" << this->messageIds.at(gapMessageIndex + 1);
+    this->inIncrementalUpdate = true;
+    this->inGapFill = true;
+    this->gapFillMessageId = gapMessageId;
+    this->requestChatHistory(this->messageIds.at(gapMessageIndex + 1), -1, false);
+}
+
+int ChatModel::indexOfDeferredMessage(const QString &messageId)
+{
+    for (int i = 0; i < this->deferredMessages.size(); i++) {
+        if (this->deferredMessages.at(i).toMap().value("id").toString() == messageId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ChatModel::clearDeferredUpdates()
+{
+    this->deferredMessages.clear();
+    this->deferredDeletedMessageIds.clear();
+    this->deferredChangedMessageIds.clear();
+    this->deferredReadInboxUpdate = false;
+    this->deferredReadOutboxUpdate = false;
+}
+
+void ChatModel::applyDeferredUpdates()
+{
+    // Everything that happened in the background reaches the view as one batch of changes
+    qDebug() << "[ChatModel] Application active again, applying" << this->deferredMessages.size() << "new," << this->deferredDeletedMessageIds.size() << "deleted and" << this->deferredChangedMessageIds.size() << "changed messages";
+    if (!this->deferredDeletedMessageIds.isEmpty()) {
+        this->messagesMutex.lock();
+        this->removeMessages(this->deferredDeletedMessageIds);
+        this->messagesMutex.unlock();
+        emit messagesDeleted();
+    }
+    if (!this->deferredMessages.isEmpty()) {
+        this->messagesMutex.lock();
+        this->messagesToBeAdded = this->deferredMessages;
+        std::sort(this->messagesToBeAdded.begin(), this->messagesToBeAdded.end(), compareMessages);
+        this->insertMessages();
+        this->messagesMutex.unlock();
+        emit newMessageReceived();
+    }
+    QSetIterator<QString> changedMessageIdIterator(this->deferredChangedMessageIds);
+    while (changedMessageIdIterator.hasNext()) {
+        QString changedMessageId = changedMessageIdIterator.next();
+        int messageIndex = this->indexOfMessage(changedMessageId);
+        if (messageIndex != -1) {
+            emit dataChanged(index(messageIndex), index(messageIndex));
+        }
+    }
+    if (this->deferredReadOutboxUpdate) {
+        this->updateLastReadOutboxMessage(this->chatInformation.value("last_read_outbox_message_id").toLongLong());
+    }
+    if (this->deferredReadInboxUpdate) {
+        emit unreadCountUpdated(this->chatInformation.value("unread_count").toInt(), this->chatInformation.value("last_read_inbox_message_id").toString());
+    }
+    this->clearDeferredUpdates();
+}
+
+QVariantList ChatModel::getWaveform(const QVariantMap &message) const
+{
+    QVariantMap content = message.value("content").toMap();
+    if (content.value("@type").toString() != "messageVoiceNote") {
+        return QVariantList();
+    }
+    QVariantMap voiceNote = content.value("voice_note").toMap();
+    QString fileId = voiceNote.value("voice").toMap().value("id").toString();
+    QHash<QString, QVariantList>::const_iterator waveform = this->waveforms.constFind(fileId);
+    if (waveform != this->waveforms.constEnd()) {
+        return waveform.value();
+    }
+    return this->waveforms.insert(fileId, decodeWaveform(QByteArray::fromBase64(voiceNote.value("waveform").toByteArray()))).value();
+}
+
+QVariantList ChatModel::decodeWaveform(const QByteArray &waveformBytes)
+{
+    // Values have 5 bits each and are packed starting at the least significant bit, so a value spans at most two bytes
+    const unsigned char *waveformData = reinterpret_cast<const unsigned char *>(waveformBytes.constData());
+    const int byteCount = waveformBytes.size();
+    const int valueCount = byteCount * 8 / 5;
+    QVariantList waveform;
+    waveform.reserve(valueCount);
+    for (int i = 0; i < valueCount; i++) {
+        const int bitOffset = i * 5;
+        const int byteIndex = bitOffset >> 3;
+        unsigned int packedBits = waveformData[byteIndex];
+        if (byteIndex + 1 < byteCount) {
+            packedBits |= static_cast<unsigned int>(waveformData[byteIndex + 1]) << 8;
+        }
+        waveform.append(static_cast<int>((packedBits >> (bitOffset & 7)) & 31));
+    }
+    return waveform;
+}
+
+QString ChatModel::getRenderedText(const QVariantMap &message) const
+{
+    // Rendering is done once per version of a message, scrolling back and forth only hits the cache
+    QString messageId = message.value("id").toString();
+    qint64 editDate = message.value("edit_date").toLongLong();
+    QHash<QString, RenderedMessageText>::const_iterator renderedText = this->renderedTextCache.constFind(messageId);
+    if (renderedText != this->renderedTextCache.constEnd() && renderedText.value().editDate == editDate) {
+        return renderedText.value().text;
+    }
+    RenderedMessageText newRenderedText;
+    newRenderedText.editDate = editDate;
+    newRenderedText.text = this->emojiEngine->emojify(MessageFormatter::getMessageRichText(message), EmojiEngine::SmallFont);
+    return this->renderedTextCache.insert(messageId, newRenderedText).value().text;
+}
+
+const ChatModel::SenderInformation &ChatModel::getSender(const QString &userId) const
+{
+    QHash<QString, SenderInformation>::const_iterator sender = this->senders.constFind(userId);
+    if (sender != this->senders.constEnd()) {
+        return sender.value();
+    }
+    return this->senders.insert(userId, this->createSender(this->tdLibWrapper->getUserInformation(userId))).value();
+}
+
+ChatModel::SenderInformation ChatModel::createSender(const QVariantMap &userInformation) const
+{
+    SenderInformation sender;
+    sender.name = this->emojiEngine->emojify(MessageFormatter::escapeHtml(MessageFormatter::getUserName(userInformation)), EmojiEngine::ExtraSmallFont);
+    QVariantMap profilePhoto = userInformation.value("profile_photo").toMap();
+    sender.photo = profilePhoto.contains("small") ? profilePhoto.value("small") : QVariant(QString());
+    return sender;
+}
+
+QVariantMap ChatModel::getReplyPreview(const QVariantMap &message) const
+{
+    QString repliedMessageId = message.value("reply_to_message_id").toString();
+    if (repliedMessageId.isEmpty() || repliedMessageId == "0") {
+        return QVariantMap();
+    }
+    QString cacheKey = this->chatId + ":" + repliedMessageId;
+    QVariantMap *replyPreview = this->replyPreviews.object(cacheKey);
+    if (replyPreview) {
+        return *replyPreview;
+    }
+    // Most replies refer to messages close by, which are usually loaded already
+    int repliedMessageIndex = this->indexOfMessage(repliedMessageId);
+    if (repliedMessageIndex != -1) {
+        QVariantMap createdReplyPreview = this->createReplyPreview(this->messages.at(repliedMessageIndex).toMap());
+        this->replyPreviews.insert(cacheKey, new QVariantMap(createdReplyPreview));
+        return createdReplyPreview;
+    }
+    if (!this->requestedReplyMessageIds.contains(repliedMessageId) && !this->pendingReplyMessageIds.contains(repliedMessageId)) {
+        this->pendingReplyMessageIds.insert(repliedMessageId);
+        if (!this->replyPreviewTimer.isActive()) {
+            this->replyPreviewTimer.start();
+        }
+    }
+    return QVariantMap();
+}
+
+QVariantMap ChatModel::createReplyPreview(const QVariantMap &repliedMessage) const
+{
+    QVariantMap replyPreview;
+    if (repliedMessage.isEmpty()) {
+        replyPreview.insert("sender", QString());
+        replyPreview.insert("text", tr("Message not available"));
+        return replyPreview;
     }
-    return enhancedMessage;
+    QString senderUserId = repliedMessage.value("sender_user_id").toString();
+    replyPreview.insert("sender", senderUserId == this->ownUserId ? tr("You") : this->getSender(senderUserId).name);
+    replyPreview.insert("text", this->emojiEngine->emojify(MessageFormatter::escapeHtml(MessageFormatter::getMessageText(repliedMessage)), EmojiEngine::ExtraSmallFont));
+    return replyPreview;
 }
 
 int ChatModel::calculateLastKnownMessageId()
@@ -321,9 +1169,11 @@ int ChatModel::calculateLastKnownMessageId()
     qDebug() << "[ChatModel] calculateLastKnownMessageId";
     QString lastKnownMessageId = this->chatInformation.value("last_read_inbox_message_id").toString();
     qDebug() << "[ChatModel] lastKnownMessageId" << lastKnownMessageId;
-    qDebug() << "[ChatModel] size messageIndexMap" << this->messageIndexMap.size();
-    qDebug() << "[ChatModel] contains ID?" << this->messageIndexMap.contains(lastKnownMessageId);
-    int listInboxPosition = this->messageIndexMap.value(lastKnownMessageId, this->messages.size() - 1).toInt();
+    int listInboxPosition = this->indexOfMessage(lastKnownMessageId);
+    qDebug() << "[ChatModel] contains ID?" << (listInboxPosition != -1);
+    if (listInboxPosition == -1) {
+        listInboxPosition = this->messages.size() - 1;
+    }
     if (listInboxPosition > this->messages.size() - 1 ) {
         listInboxPosition = this->messages.size() - 1;
     }
@@ -331,23 +1181,220 @@ int ChatModel::calculateLastKnownMessageId()
     return listInboxPosition;
 }
 
-int ChatModel::calculateLastReadSentMessageId()
+QString ChatModel::getSendState(const QVariantMap &message) const
 {
-    qDebug() << "[ChatModel] calculateLastReadSentMessageId";
-    QString lastReadSentMessageId = this->chatInformation.value("last_read_outbox_message_id").toString();
-    qDebug() << "[ChatModel] lastReadSentMessageId" << lastReadSentMessageId;
-    qDebug() << "[ChatModel] size messageIndexMap" << this->messageIndexMap.size();
-    qDebug() << "[ChatModel] contains ID?" << this->messageIndexMap.contains(lastReadSentMessageId);
-    int listOutboxPosition = this->messageIndexMap.value(lastReadSentMessageId, this->messages.size() - 1).toInt();
-    qDebug() << "[ChatModel] Last read sent message is at position" << listOutboxPosition;
-    return listOutboxPosition;
+    if (message.value("sender_user_id").toString() != this->ownUserId) {
+        return QString();
+    }
+    QString sendingState = message.value("sending_state").toMap().value("@type").toString();
+    if (sendingState == "messageSendingStatePending") {
+        return "pending";
+    }
+    if (sendingState == "messageSendingStateFailed") {
+        return "failed";
+    }
+    return (message.value("id").toLongLong() <= this->lastReadOutboxMessageId) ? "read" : "sent";
 }
 
-void ChatModel::calculateMessageIndexMap()
+void ChatModel::updateLastReadOutboxMessage(const qint64 &lastReadOutboxMessageId)
 {
-    qDebug() << "[ChatModel] calculateMessageIndexMap";
-    this->messageIndexMap.clear();
-    for (int i = 0; i < this->messages.size(); i++) {
-        this->messageIndexMap.insert(this->messages.at(i).toMap().value("id").toString(), i);
+    // Only own messages between the old and the new read marker change their state
+    qint64 previousLastReadOutboxMessageId = this->lastReadOutboxMessageId;
+    this->lastReadOutboxMessageId = lastReadOutboxMessageId;
+    qint64 lowerMessageId = qMin(previousLastReadOutboxMessageId, lastReadOutboxMessageId);
+    qint64 upperMessageId = qMax(previousLastReadOutboxMessageId, lastReadOutboxMessageId);
+    int firstIndex = static_cast<int>(std::upper_bound(this->messageIds.constBegin(), this->messageIds.constEnd(), lowerMessageId) - this->messageIds.constBegin());
+    int lastIndex = static_cast<int>(std::upper_bound(this->messageIds.constBegin(), this->messageIds.constEnd(), upperMessageId) - this->messageIds.constBegin()) - 1;
+    qDebug() << "[ChatModel] Read marker of sent messages moved to" << lastReadOutboxMessageId << ", checking rows" << firstIndex << "to" << lastIndex;
+    QVector<int> changedRoles;
+    changedRoles.append(SendStateRole);
+    int rangeStart = -1;
+    for (int i = firstIndex; i <= lastIndex + 1; i++) {
+        bool ownMessage = (i <= lastIndex) && this->messages.at(i).toMap().value("sender_user_id").toString() == this->ownUserId;
+        if (ownMessage && rangeStart == -1) {
+            rangeStart = i;
+        } else if (!ownMessage && rangeStart != -1) {
+            emit dataChanged(this->index(rangeStart), this->index(i - 1), changedRoles);
+            rangeStart = -1;
+        }
+    }
+}
+
+int ChatModel::indexOfMessage(const QString &messageId) const
+{
+    return indexOfMessageId(this->messageIds, messageId);
+}
+
+int ChatModel::indexOfMessageId(const QVector<qint64> &messageIds, const QString &messageId)
+{
+    // Messages are always kept in ascending ID order, so a binary search finds the row
+    bool validId;
+    qint64 numericMessageId = messageId.toLongLong(&validId);
+    if (!validId) {
+        return -1;
+    }
+    QVector<qint64>::const_iterator messageIdIterator = std::lower_bound(messageIds.constBegin(), messageIds.constEnd(), numericMessageId);
+    if (messageIdIterator == messageIds.constEnd() || *messageIdIterator != numericMessageId) {
+        return -1;
+    }
+    return static_cast<int>(messageIdIterator - messageIds.constBegin());
+}
+
+void ChatModel::storeChatState()
+{
+    if (this->chatId.isEmpty() || this->messages.isEmpty()) {
+        return;
+    }
+    if (this->messages.size() > CHAT_STATE_CACHE_BUDGET) {
+        qDebug() << "[ChatModel] Too many messages to keep chat" << this->chatId << "in cache";
+        return;
+    }
+    ChatState chatState;
+    chatState.messages = this->messages;
+    chatState.messageIds = this->messageIds;
+    chatState.hasNewerMessages = this->hasNewerMessages;
+    chatState.lowestLoadedMessageId = this->lowestLoadedMessageId;
+    chatState.highestLoadedMessageId = this->highestLoadedMessageId;
+    chatState.scrollAnchorMessageId = this->scrollAnchorMessageId;
+    chatState.gapMessageIds = this->gapMessageIds;
+    this->cachedMessageCount -= this->chatStateCache.value(this->chatId).messages.size();
+    this->chatStateCache.insert(this->chatId, chatState);
+    this->cachedMessageCount += chatState.messages.size();
+    this->recentlyCachedChatIds.removeAll(this->chatId);
+    this->recentlyCachedChatIds.append(this->chatId);
+    this->evictCachedChatStates();
+    qDebug() << "[ChatModel] Chat" << this->chatId << "cached," << this->chatStateCache.size() << "chats with" << this->cachedMessageCount << "messages in cache";
+}
+
+bool ChatModel::restoreChatState(const QString &anchorMessageId)
+{
+    if (!this->chatStateCache.contains(this->chatId)) {
+        return false;
+    }
+    // Jumps to a message outside the cached range need a fresh load
+    ChatState chatState = this->chatStateCache.value(this->chatId);
+    bool defaultAnchor = (anchorMessageId == this->chatInformation.value("last_read_inbox_message_id").toString());
+    if (!defaultAnchor && indexOfMessageId(chatState.messageIds, anchorMessageId) == -1) {
+        return false;
+    }
+    this->chatStateCache.remove(this->chatId);
+    this->recentlyCachedChatIds.removeAll(this->chatId);
+    this->cachedMessageCount -= chatState.messages.size();
+
+    qDebug() << "[ChatModel] Restoring" << chatState.messages.size() << "cached messages of chat" << this->chatId;
+    this->messagesMutex.lock();
+    beginResetModel();
+    this->messages = chatState.messages;
+    this->messageIds = chatState.messageIds;
+    this->rebuildMessageGroupings();
+    endResetModel();
+    this->messagesMutex.unlock();
+    this->hasNewerMessages = chatState.hasNewerMessages;
+    this->lowestLoadedMessageId = chatState.lowestLoadedMessageId;
+    this->highestLoadedMessageId = chatState.highestLoadedMessageId;
+    this->gapMessageIds = chatState.gapMessageIds;
+    this->networkTopUpPending = false;
+    if (defaultAnchor && !chatState.scrollAnchorMessageId.isEmpty()) {
+        this->anchorMessageId = chatState.scrollAnchorMessageId;
+    }
+    this->notifyHistoryLoaded();
+    return true;
+}
+
+void ChatModel::updateCachedChatState(const QString &chatId, const QVariantMap &message, const QString &replacedMessageId)
+{
+    // Cached chats are kept up to date, so they can be shown again right away
+    if (!this->chatStateCache.contains(chatId)) {
+        return;
+    }
+    ChatState &chatState = this->chatStateCache[chatId];
+    if (!replacedMessageId.isEmpty()) {
+        int replacedMessageIndex = indexOfMessageId(chatState.messageIds, replacedMessageId);
+        if (replacedMessageIndex == -1) {
+            return;
+        }
+        chatState.messages.removeAt(replacedMessageIndex);
+        chatState.messageIds.removeAt(replacedMessageIndex);
+        this->cachedMessageCount--;
+    } else if (chatState.hasNewerMessages && message.value("id").toLongLong() < MessageOutbox::FIRST_LOCAL_MESSAGE_ID) {
+        return;
+    }
+    qint64 messageId = message.value("id").toLongLong();
+    QVector<qint64>::iterator insertionPoint = std::lower_bound(chatState.messageIds.begin(), chatState.messageIds.end(), messageId);
+    if (insertionPoint != chatState.messageIds.end() && *insertionPoint == messageId) {
+        return;
+    }
+    int insertionIndex = static_cast<int>(insertionPoint - chatState.messageIds.begin());
+    chatState.messageIds.insert(insertionIndex, messageId);
+    chatState.messages.insert(insertionIndex, message);
+    this->cachedMessageCount++;
+
+    // Busy chats would grow without bounds while cached, they keep a message window of their own
+    int excessMessages = chatState.messages.size() - this->messageWindowSize;
+    if (excessMessages > 0) {
+        for (int i = 0; i < excessMessages; i++) {
+            chatState.gapMessageIds.remove(chatState.messageIds.at(i));
+        }
+        chatState.messages.erase(chatState.messages.begin(), chatState.messages.begin() + excessMessages);
+        chatState.messageIds.remove(0, excessMessages);
+        chatState.lowestLoadedMessageId = chatState.messageIds.first();
+        if (indexOfMessageId(chatState.messageIds, chatState.scrollAnchorMessageId) == -1) {
+            chatState.scrollAnchorMessageId.clear();
+        }
+        this->cachedMessageCount -= excessMessages;
+    }
+    this->evictCachedChatStates();
+}
+
+void ChatModel::removeFromCachedChatState(const QString &chatId, const QVariantList &messageIds)
+{
+    if (!this->chatStateCache.contains(chatId)) {
+        return;
+    }
+    ChatState &chatState = this->chatStateCache[chatId];
+    QListIterator<QVariant> messageIdIterator(messageIds);
+    while (messageIdIterator.hasNext()) {
+        int messageIndex = indexOfMessageId(chatState.messageIds, messageIdIterator.next().toString());
+        if (messageIndex != -1) {
+            chatState.messages.removeAt(messageIndex);
+            chatState.messageIds.removeAt(messageIndex);
+            this->cachedMessageCount--;
+        }
+    }
+}
+
+void ChatModel::evictCachedChatStates()
+{
+    // Least recently used chats leave the cache first
+    while (this->cachedMessageCount > CHAT_STATE_CACHE_BUDGET && !this->recentlyCachedChatIds.isEmpty()) {
+        QString evictedChatId = this->recentlyCachedChatIds.takeFirst();
+        this->cachedMessageCount -= this->chatStateCache.take(evictedChatId).messages.size();
+        qDebug() << "[ChatModel] Chat" << evictedChatId << "removed from cache";
+    }
+}
+
+void ChatModel::moveReplacedMessage(const int &messageIndex)
+{
+    // The final ID of a sent message may be beyond the IDs of messages received in the meantime
+    qint64 messageId = this->messageIds.at(messageIndex);
+    int targetIndex = messageIndex;
+    while (targetIndex + 1 < this->messageIds.size() && this->messageIds.at(targetIndex + 1) < messageId) {
+        targetIndex++;
+    }
+    while (targetIndex > 0 && this->messageIds.at(targetIndex - 1) > messageId) {
+        targetIndex--;
+    }
+    if (targetIndex != messageIndex) {
+        qDebug() << "[ChatModel] Moving sent message from index " << messageIndex << " to " << targetIndex;
+        beginMoveRows(QModelIndex(), messageIndex, messageIndex, QModelIndex(), (targetIndex > messageIndex) ? (targetIndex + 1) : targetIndex);
+        this->messages.move(messageIndex, targetIndex);
+        this->messageIds.move(messageIndex, targetIndex);
+        MessageGrouping movedGrouping = this->messageGroupings.at(messageIndex);
+        this->messageGroupings.remove(messageIndex);
+        this->messageGroupings.insert(targetIndex, movedGrouping);
+        endMoveRows();
+        // The rows which were next to the message before are neighbours now
+        int closedRow = (targetIndex > messageIndex) ? messageIndex : messageIndex + 1;
+        this->updateAdjacentGroupings(closedRow, closedRow - 1);
     }
 }
@@ -21,34 +21,62 @@
 #define CHATMODEL_H
 
 #include <QAbstractListModel>
+#include <QCache>
 #include <QDebug>
 #include <QMutex>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
 #include "tdlibwrapper.h"
+#include "relativetimeclock.h"
+#include "emojiengine.h"
 
 class ChatModel : public QAbstractListModel
 {
     Q_OBJECT
 public:
-    ChatModel(TDLibWrapper *tdLibWrapper);
+    ChatModel(TDLibWrapper *tdLibWrapper, RelativeTimeClock *relativeTimeClock, EmojiEngine *emojiEngine);
     ~ChatModel() override;
 
+    enum ChatRole {
+        MessageElapsedRole = Qt::UserRole + 1,
+        MessageTextRole,
+        ContentTypeRole,
+        OwnMessageRole,
+        SenderNameRole,
+        SenderPhotoRole,
+        SendStateRole,
+        EditedRole,
+        ViewCountRole,
+        ReplyPreviewRole,
+        FirstInRunRole,
+        LastInRunRole,
+        AlbumIndexRole,
+        DayBoundaryRole,
+        WaveformRole
+    };
+
+    virtual QHash<int, QByteArray> roleNames() const override;
     virtual int rowCount(const QModelIndex&) const override;
     virtual QVariant data(const QModelIndex &index, int role) const override;
     virtual bool insertRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
 
     Q_INVOKABLE void initialize(const QVariantMap &chatInformation);
+    Q_INVOKABLE void initialize(const QVariantMap &chatInformation, const QString &anchorMessageId);
     Q_INVOKABLE void triggerLoadMoreHistory();
+    Q_INVOKABLE void triggerLoadMoreFuture();
+    Q_INVOKABLE void setScrollAnchor(const QString &messageId);
+    Q_INVOKABLE void reportVisibleRange(const int &firstRow, const int &lastRow);
     Q_INVOKABLE QVariantMap getChatInformation();
     Q_INVOKABLE QVariantMap getMessage(const int &index);
 
 signals:
-    void messagesReceived(const int &modelIndex, const int &lastReadSentIndex);
-    void messagesIncrementalUpdate(const int &modelIndex, const int &lastReadSentIndex);
+    void messagesReceived(const int &modelIndex);
+    void messagesIncrementalUpdate(const int &modelIndex);
     void newMessageReceived();
     void unreadCountUpdated(const int &unreadCount, const QString &lastReadInboxMessageId);
-    void lastReadSentMessageUpdated(const int &lastReadSentIndex);
     void notificationSettingsUpdated();
-    void messageUpdated(const int &modelIndex);
     void messagesDeleted();
 
 public slots:
@@ -57,27 +85,135 @@ public slots:
     void handleChatReadInboxUpdated(const QString &chatId, const QString &lastReadInboxMessageId, const int &unreadCount);
     void handleChatReadOutboxUpdated(const QString &chatId, const QString &lastReadOutboxMessageId);
     void handleMessageSendSucceeded(const QString &messageId, const QString &oldMessageId, const QVariantMap &message);
+    void handleMessageSendFailed(const QString &messageId, const QString &oldMessageId, const QVariantMap &message);
     void handleChatNotificationSettingsUpdated(const QString &chatId, const QVariantMap &chatNotificationSettings);
     void handleMessageContentUpdated(const QString &chatId, const QString &messageId, const QVariantMap &newContent);
+    void handleMessageEdited(const QString &chatId, const QString &messageId, const int &editDate);
+    void handleMessageViewsUpdated(const QString &chatId, const QString &messageId, const int &views);
     void handleMessagesDeleted(const QString &chatId, const QVariantList &messageIds);
+    void handleUserUpdated(const QString &userId, const QVariantMap &userInformation);
+    void handleMessagesFetched(const QString &chatId, const QVariantList &messageIds, const QVariantList &messages);
+    void handleMinuteChanged();
+    void handleFontSizesChanged();
+    void flushViewedMessages();
+
+private slots:
+    void handleApplicationStateChanged(Qt::ApplicationState applicationState);
+    void requestReplyPreviews();
 
 private:
+    struct ChatState {
+        QVariantList messages;
+        QVector<qint64> messageIds;
+        bool hasNewerMessages;
+        qint64 lowestLoadedMessageId;
+        qint64 highestLoadedMessageId;
+        QString scrollAnchorMessageId;
+        QSet<qint64> gapMessageIds;
+    };
+
+    struct SenderInformation {
+        QString name;
+        QVariant photo;
+    };
+
+    struct MessageGrouping {
+        bool firstInRun;
+        bool lastInRun;
+        int albumIndex;
+        bool dayBoundary;
+    };
+
+    struct RenderedMessageText {
+        qint64 editDate;
+        QString text;
+    };
 
     TDLibWrapper *tdLibWrapper;
+    EmojiEngine *emojiEngine;
     QVariantList messages;
     QVariantList messagesToBeAdded;
-    QVariantMap messageIndexMap;
+    QVector<qint64> messageIds;
+    QVector<MessageGrouping> messageGroupings;
     QMutex messagesMutex;
     QVariantMap chatInformation;
     QString chatId;
+    QString anchorMessageId;
+    QString scrollAnchorMessageId;
+    QHash<QString, ChatState> chatStateCache;
+    QStringList recentlyCachedChatIds;
+    int cachedMessageCount;
+    mutable QHash<QString, RenderedMessageText> renderedTextCache;
+    mutable QHash<QString, SenderInformation> senders;
+    mutable QHash<QString, QVariantList> waveforms;
+    QString ownUserId;
+    mutable QCache<QString, QVariantMap> replyPreviews;
+    mutable QSet<QString> pendingReplyMessageIds;
+    QSet<QString> requestedReplyMessageIds;
+    mutable QTimer replyPreviewTimer;
+    QSet<qint64> viewedMessageIds;
+    QVariantList pendingViewedMessageIds;
+    QTimer viewMessagesTimer;
+    qint64 lastReadOutboxMessageId;
     bool inReload;
     bool inIncrementalUpdate;
+    bool loadingNewerMessages;
+    bool hasNewerMessages;
+    int messageWindowSize;
+    qint64 lowestLoadedMessageId;
+    qint64 highestLoadedMessageId;
+    bool inLocalHistoryRequest;
+    qint64 historyRequestFromMessageId;
+    int historyRequestOffset;
+    bool networkTopUpPending;
+    bool inNetworkTopUp;
+    qint64 initialFromMessageId;
+    int initialOffset;
+    QElapsedTimer openTimer;
+    QSet<qint64> gapMessageIds;
+    bool inGapFill;
+    qint64 gapFillMessageId;
+    bool deferredUpdates;
+    QVariantList deferredMessages;
+    QVariantList deferredDeletedMessageIds;
+    QSet<QString> deferredChangedMessageIds;
+    bool deferredReadInboxUpdate;
+    bool deferredReadOutboxUpdate;
 
     void insertMessages();
-    QVariantMap enhanceMessage(const QVariantMap &message);
+    void removeMessages(const QVariantList &messageIds);
+    void removeMessageRange(const int &firstRow, const int &lastRow);
+    void updateMessage(const QString &chatId, const QString &messageId, const QString &fieldName, const QVariant &fieldValue, const QVector<int> &changedRoles);
+    void evictMessages();
+    void rebuildMessageGroupings();
+    bool updateMessageGrouping(const int &row);
+    void updateAdjacentGroupings(const int &firstRow, const int &lastRow);
+    void requestChatHistory(const qint64 &fromMessageId, const int &offset, const bool &onlyLocal);
+    void notifyHistoryLoaded();
+    void updateGapMarkers(const qint64 &batchFirstMessageId, const qint64 &batchLastMessageId);
+    void fillNextGap();
+    int indexOfDeferredMessage(const QString &messageId);
+    void clearDeferredUpdates();
+    void applyDeferredUpdates();
+    QVariantList getWaveform(const QVariantMap &message) const;
+    static QVariantList decodeWaveform(const QByteArray &waveformBytes);
+    QString getRenderedText(const QVariantMap &message) const;
+    const SenderInformation &getSender(const QString &userId) const;
+    SenderInformation createSender(const QVariantMap &userInformation) const;
+    QVariantMap getReplyPreview(const QVariantMap &message) const;
+    QVariantMap createReplyPreview(const QVariantMap &repliedMessage) const;
     int calculateLastKnownMessageId();
-    int calculateLastReadSentMessageId();
-    void calculateMessageIndexMap();
+    QString getSendState(const QVariantMap &message) const;
+    void updateLastReadOutboxMessage(const qint64 &lastReadOutboxMessageId);
+    int indexOfMessage(const QString &messageId) const;
+    static int indexOfMessageId(const QVector<qint64> &messageIds, const QString &messageId);
+    void storeChatState();
+    bool restoreChatState(const QString &anchorMessageId);
+    void updateCachedChatState(const QString &chatId, const QVariantMap &message, const QString &replacedMessageId);
+    void removeFromCachedChatState(const QString &chatId, const QVariantList &messageIds);
+    void evictCachedChatStates();
+    void replaceMessage(const QString &messageId, const QString &oldMessageId, const QVariantMap &message);
+    void moveReplacedMessage(const int &messageIndex);
 };
 
 #endif // CHATMODEL_H
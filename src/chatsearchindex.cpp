@@ -0,0 +1,114 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "chatsearchindex.h"
+#include <QListIterator>
+
+void ChatSearchIndex::setChatTitle(const QString &chatId, const QString &title)
+{
+    this->removeChat(chatId);
+    QStringList words = tokenize(title);
+    words.removeDuplicates();
+    QListIterator<QString> wordIterator(words);
+    while (wordIterator.hasNext()) {
+        this->wordIndex[wordIterator.next()].insert(chatId);
+    }
+    this->chatWords.insert(chatId, words);
+}
+
+void ChatSearchIndex::removeChat(const QString &chatId)
+{
+    QListIterator<QString> wordIterator(this->chatWords.value(chatId));
+    while (wordIterator.hasNext()) {
+        QString word = wordIterator.next();
+        QMap<QString, QSet<QString> >::iterator wordEntry = this->wordIndex.find(word);
+        if (wordEntry != this->wordIndex.end()) {
+            wordEntry.value().remove(chatId);
+            if (wordEntry.value().isEmpty()) {
+                this->wordIndex.erase(wordEntry);
+            }
+        }
+    }
+    this->chatWords.remove(chatId);
+}
+
+QSet<QString> ChatSearchIndex::search(const QStringList &searchTerms) const
+{
+    // Every search term has to be the prefix of at least one word of the title
+    QSet<QString> matchingChats;
+    for (int i = 0; i < searchTerms.size(); i++) {
+        QSet<QString> termMatches = this->searchPrefix(searchTerms.at(i));
+        if (i == 0) {
+            matchingChats = termMatches;
+        } else {
+            matchingChats.intersect(termMatches);
+        }
+        if (matchingChats.isEmpty()) {
+            break;
+        }
+    }
+    return matchingChats;
+}
+
+bool ChatSearchIndex::matches(const QString &chatId, const QStringList &searchTerms) const
+{
+    const QStringList words = this->chatWords.value(chatId);
+    QListIterator<QString> termIterator(searchTerms);
+    while (termIterator.hasNext()) {
+        QString searchTerm = termIterator.next();
+        bool termFound = false;
+        QListIterator<QString> wordIterator(words);
+        while (wordIterator.hasNext() && !termFound) {
+            termFound = wordIterator.next().startsWith(searchTerm);
+        }
+        if (!termFound) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QStringList ChatSearchIndex::tokenize(const QString &text)
+{
+    // Decomposing first, so that diacritics become separate marks which can be dropped.
+    // Emoji and other symbols are treated as word separators.
+    QString decomposedText = text.normalized(QString::NormalizationForm_KD).toCaseFolded();
+    QString normalizedText;
+    normalizedText.reserve(decomposedText.length());
+    for (int i = 0; i < decomposedText.length(); i++) {
+        const QChar currentCharacter = decomposedText.at(i);
+        if (currentCharacter.isLetterOrNumber()) {
+            normalizedText.append(currentCharacter);
+        } else if (currentCharacter.category() != QChar::Mark_NonSpacing) {
+            normalizedText.append(' ');
+        }
+    }
+    return normalizedText.split(' ', QString::SkipEmptyParts);
+}
+
+QSet<QString> ChatSearchIndex::searchPrefix(const QString &prefix) const
+{
+    QSet<QString> matchingChats;
+    QMap<QString, QSet<QString> >::const_iterator wordEntry = this->wordIndex.lowerBound(prefix);
+    while (wordEntry != this->wordIndex.constEnd() && wordEntry.key().startsWith(prefix)) {
+        matchingChats.unite(wordEntry.value());
+        ++wordEntry;
+    }
+    return matchingChats;
+}
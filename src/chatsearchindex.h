@@ -0,0 +1,49 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CHATSEARCHINDEX_H
+#define CHATSEARCHINDEX_H
+
+#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// Word prefix index over normalized chat titles. Words are kept in a sorted map,
+// so all words starting with a given prefix form one contiguous key range.
+class ChatSearchIndex
+{
+public:
+    void setChatTitle(const QString &chatId, const QString &title);
+    void removeChat(const QString &chatId);
+
+    QSet<QString> search(const QStringList &searchTerms) const;
+    bool matches(const QString &chatId, const QStringList &searchTerms) const;
+
+    static QStringList tokenize(const QString &text);
+
+private:
+    QMap<QString, QSet<QString> > wordIndex;
+    QHash<QString, QStringList> chatWords;
+
+    QSet<QString> searchPrefix(const QString &prefix) const;
+};
+
+#endif // CHATSEARCHINDEX_H
@@ -0,0 +1,208 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "emojiengine.h"
+#include <sailfishapp.h>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QDebug>
+
+namespace {
+    const int EMOJIFIED_TEXTS_CACHE_SIZE = 262144;
+    const uint VARIATION_SELECTOR_TEXT = 0xFE0E;
+    const uint VARIATION_SELECTOR_EMOJI = 0xFE0F;
+
+    uint codePointAt(const QString &text, const int &position, int &length)
+    {
+        const QChar currentCharacter = text.at(position);
+        if (currentCharacter.isHighSurrogate() && position + 1 < text.length() && text.at(position + 1).isLowSurrogate()) {
+            length = 2;
+            return QChar::surrogateToUcs4(currentCharacter, text.at(position + 1));
+        }
+        length = 1;
+        return currentCharacter.unicode();
+    }
+
+    // Tells whether there is an HTML entity like &amp; at the given position
+    bool isHtmlEntity(const QString &text, const int &position)
+    {
+        int i = position + 1;
+        while (i < text.length() && (text.at(i).isLetterOrNumber() || text.at(i) == '#')) {
+            i++;
+        }
+        return i > position + 1 && i < text.length() && text.at(i) == ';';
+    }
+}
+
+EmojiEngine::EmojiEngine(QObject *parent) : QObject(parent), emojifiedTexts(EMOJIFIED_TEXTS_CACHE_SIZE)
+{
+    this->fontSizes[ExtraSmallFont] = 24;
+    this->fontSizes[SmallFont] = 28;
+    this->fontSizes[MediumFont] = 32;
+    this->loadEmojiFiles();
+}
+
+EmojiEngine::~EmojiEngine()
+{
+    qDebug() << "[EmojiEngine] Destroying myself...";
+}
+
+QString EmojiEngine::emojify(const QString &text, const int &size)
+{
+    if (text.isEmpty()) {
+        return text;
+    }
+    QString cacheKey = QString::number(size) + ":" + text;
+    QString *emojifiedText = this->emojifiedTexts.object(cacheKey);
+    if (emojifiedText) {
+        return *emojifiedText;
+    }
+    emojifiedText = new QString(this->replaceEmoji(text, size));
+    QString result = *emojifiedText;
+    this->emojifiedTexts.insert(cacheKey, emojifiedText, cacheKey.length() + result.length());
+    return result;
+}
+
+QString EmojiEngine::emojify(const QString &text, const EmojiEngine::FontSize &fontSize)
+{
+    return this->emojify(text, this->fontSizes[fontSize]);
+}
+
+void EmojiEngine::setFontSizes(const int &extraSmall, const int &small, const int &medium)
+{
+    if (this->fontSizes[ExtraSmallFont] == extraSmall && this->fontSizes[SmallFont] == small && this->fontSizes[MediumFont] == medium) {
+        return;
+    }
+    qDebug() << "[EmojiEngine] Font sizes" << extraSmall << small << medium;
+    this->fontSizes[ExtraSmallFont] = extraSmall;
+    this->fontSizes[SmallFont] = small;
+    this->fontSizes[MediumFont] = medium;
+    emit fontSizesChanged();
+}
+
+void EmojiEngine::loadEmojiFiles()
+{
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+    this->trieNodes.append(EmojiTrieNode());
+    QDir emojiDirectory(SailfishApp::pathTo("qml/js/emoji").toLocalFile());
+    QStringList emojiFiles = emojiDirectory.entryList(QStringList("*.svg"), QDir::Files);
+    QListIterator<QString> emojiFilesIterator(emojiFiles);
+    while (emojiFilesIterator.hasNext()) {
+        QString emojiFile = emojiFilesIterator.next();
+        this->insertEmoji(emojiFile.left(emojiFile.length() - 4));
+    }
+    qDebug() << "[EmojiEngine] Loaded" << emojiFiles.size() << "emoji into" << this->trieNodes.size() << "trie nodes in" << loadTimer.elapsed() << "ms";
+}
+
+void EmojiEngine::insertEmoji(const QString &fileName)
+{
+    // Variation selectors are optional in texts, therefore they are skipped here and while scanning
+    QStringList codePoints = fileName.split("-");
+    int node = 0;
+    QListIterator<QString> codePointsIterator(codePoints);
+    while (codePointsIterator.hasNext()) {
+        bool validCodePoint = false;
+        uint codePoint = codePointsIterator.next().toUInt(&validCodePoint, 16);
+        if (!validCodePoint) {
+            return;
+        }
+        if (codePoint == VARIATION_SELECTOR_EMOJI) {
+            continue;
+        }
+        int child = this->trieNodes.at(node).children.value(codePoint, -1);
+        if (child == -1) {
+            child = this->trieNodes.size();
+            this->trieNodes.append(EmojiTrieNode());
+            this->trieNodes[node].children.insert(codePoint, child);
+        }
+        node = child;
+    }
+    if (this->trieNodes.at(node).fileName.isEmpty()) {
+        this->trieNodes[node].fileName = fileName;
+        // Like twemoji, these symbols are only replaced if explicitly requested by a variation selector
+        this->trieNodes[node].requiresVariationSelector = (fileName == "a9" || fileName == "ae" || fileName == "2122" || fileName == "265f");
+    }
+}
+
+QString EmojiEngine::replaceEmoji(const QString &text, const int &size) const
+{
+    QString emojifiedText;
+    emojifiedText.reserve(text.length());
+    QString imageSize = QString::number(size);
+    int i = 0;
+    while (i < text.length()) {
+        // QML's StyledText drops stray ampersands and what follows them
+        if (text.at(i) == '&' && !isHtmlEntity(text, i)) {
+            emojifiedText.append("&amp;");
+            i++;
+            continue;
+        }
+
+        // Longest match in the trie, starting at the current position
+        int codePointLength = 0;
+        uint codePoint = codePointAt(text, i, codePointLength);
+        int node = this->trieNodes.at(0).children.value(codePoint, -1);
+        int position = i + codePointLength;
+        int matchedNode = -1;
+        int matchEnd = i;
+        bool variationSelectorFound = false;
+        bool matchHasVariationSelector = false;
+        while (node != -1) {
+            if (!this->trieNodes.at(node).fileName.isEmpty()) {
+                matchedNode = node;
+                matchEnd = position;
+                matchHasVariationSelector = variationSelectorFound;
+            }
+            if (position >= text.length()) {
+                break;
+            }
+            int nextCodePointLength = 0;
+            uint nextCodePoint = codePointAt(text, position, nextCodePointLength);
+            if (nextCodePoint == VARIATION_SELECTOR_EMOJI) {
+                position += nextCodePointLength;
+                variationSelectorFound = true;
+                if (matchedNode == node) {
+                    matchEnd = position;
+                    matchHasVariationSelector = true;
+                }
+                continue;
+            }
+            node = this->trieNodes.at(node).children.value(nextCodePoint, -1);
+            position += nextCodePointLength;
+        }
+
+        bool replaceMatch = (matchedNode != -1);
+        if (replaceMatch && matchEnd < text.length() && text.at(matchEnd).unicode() == VARIATION_SELECTOR_TEXT) {
+            replaceMatch = false;
+        }
+        if (replaceMatch && this->trieNodes.at(matchedNode).requiresVariationSelector && !matchHasVariationSelector) {
+            replaceMatch = false;
+        }
+        if (replaceMatch) {
+            emojifiedText.append("<img src=\"image://emoji/" + imageSize + "/" + this->trieNodes.at(matchedNode).fileName + "\" align=\"middle\" width=\"" + imageSize + "\" height=\"" + imageSize + "\"/>");
+            i = matchEnd;
+        } else {
+            emojifiedText.append(text.midRef(i, codePointLength));
+            i += codePointLength;
+        }
+    }
+    return emojifiedText;
+}
@@ -0,0 +1,65 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EMOJIENGINE_H
+#define EMOJIENGINE_H
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QVector>
+
+// Replaces emoji by twemoji images from the emoji image provider, matching sequences with a trie built from the file names in qml/js/emoji
+class EmojiEngine : public QObject
+{
+    Q_OBJECT
+public:
+    enum FontSize {
+        ExtraSmallFont,
+        SmallFont,
+        MediumFont
+    };
+
+    explicit EmojiEngine(QObject *parent = nullptr);
+    ~EmojiEngine() override;
+
+    Q_INVOKABLE QString emojify(const QString &text, const int &size);
+    Q_INVOKABLE void setFontSizes(const int &extraSmall, const int &small, const int &medium);
+    QString emojify(const QString &text, const FontSize &fontSize);
+
+signals:
+    void fontSizesChanged();
+
+private:
+    struct EmojiTrieNode {
+        QHash<uint, int> children;
+        QString fileName;
+        bool requiresVariationSelector = false;
+    };
+
+    QVector<EmojiTrieNode> trieNodes;
+    QCache<QString, QString> emojifiedTexts;
+    int fontSizes[3];
+
+    void loadEmojiFiles();
+    void insertEmoji(const QString &fileName);
+    QString replaceEmoji(const QString &text, const int &size) const;
+};
+
+#endif // EMOJIENGINE_H
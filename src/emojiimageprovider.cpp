@@ -0,0 +1,232 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "emojiimageprovider.h"
+#include <sailfishapp.h>
+#include <QDir>
+#include <QFile>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QRunnable>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QDebug>
+
+namespace {
+    const int ATLAS_COLUMNS = 32;
+    const int ATLAS_GROWTH_ROWS = 4;
+    const int ATLAS_SAVE_DELAY = 5000;
+    const int MAXIMUM_EMOJI_SIZE = 256;
+    const QString ATLAS_FORMAT_VERSION = "1";
+    // Single emoji cut out of the atlases, the atlases themselves stay the complete store
+    const int EMOJI_IMAGE_CACHE_SIZE = 500;
+
+    class AtlasWriter : public QRunnable
+    {
+    public:
+        AtlasWriter(const QString &imagePath, const QString &indexPath, const QImage &image, const QStringList &fileNames)
+            : imagePath(imagePath), indexPath(indexPath), image(image), fileNames(fileNames) {}
+
+        void run() override
+        {
+            QFile indexFile(this->indexPath);
+            if (!this->image.save(this->imagePath, "PNG") || !indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+                qDebug() << "[EmojiImageProvider] Unable to save emoji atlas" << this->imagePath;
+                return;
+            }
+            QTextStream indexStream(&indexFile);
+            indexStream << ATLAS_FORMAT_VERSION << "\n" << this->fileNames.join("\n") << "\n";
+            qDebug() << "[EmojiImageProvider] Saved emoji atlas" << this->imagePath << "with" << this->fileNames.size() << "emoji";
+        }
+
+    private:
+        QString imagePath;
+        QString indexPath;
+        QImage image;
+        QStringList fileNames;
+    };
+}
+
+EmojiImageProvider::EmojiImageProvider() : QQuickImageProvider(QQuickImageProvider::Image)
+{
+    this->atlasDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/emoji";
+    this->saveTimer.setSingleShot(true);
+    this->saveTimer.setInterval(ATLAS_SAVE_DELAY);
+    connect(&this->saveTimer, SIGNAL(timeout()), this, SLOT(saveAtlases()));
+    this->emojiImages.setMaxCost(EMOJI_IMAGE_CACHE_SIZE);
+    // One writer at a time, so a newer copy of an atlas is never overwritten by an older one
+    this->atlasWriterPool.setMaxThreadCount(1);
+}
+
+EmojiImageProvider::~EmojiImageProvider()
+{
+    qDebug() << "[EmojiImageProvider] Destroying myself...";
+    this->atlasWriterPool.waitForDone();
+    this->writeModifiedAtlases(false);
+}
+
+QImage EmojiImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    Q_UNUSED(requestedSize)
+    // Images may be requested from QML's image loader threads
+    QMutexLocker atlasLocker(&this->atlasMutex);
+    QImage *cachedEmojiImage = this->emojiImages.object(id);
+    QImage emojiImage = cachedEmojiImage ? *cachedEmojiImage : QImage();
+    if (emojiImage.isNull()) {
+        int separatorIndex = id.indexOf('/');
+        int pixelSize = id.left(separatorIndex).toInt();
+        QString fileName = id.mid(separatorIndex + 1);
+        if (separatorIndex <= 0 || pixelSize <= 0 || pixelSize > MAXIMUM_EMOJI_SIZE || fileName.isEmpty() || fileName.contains('/')) {
+            qDebug() << "[EmojiImageProvider] Invalid emoji requested" << id;
+            return QImage();
+        }
+        EmojiAtlas &atlas = this->getAtlas(pixelSize);
+        int slotIndex = atlas.slotIndexes.value(fileName, -1);
+        if (slotIndex != -1) {
+            emojiImage = atlas.image.copy((slotIndex % ATLAS_COLUMNS) * pixelSize, (slotIndex / ATLAS_COLUMNS) * pixelSize, pixelSize, pixelSize);
+        } else {
+            emojiImage = this->rasterizeEmoji(fileName, pixelSize);
+            if (emojiImage.isNull()) {
+                return QImage();
+            }
+            this->addToAtlas(atlas, fileName, emojiImage, pixelSize);
+        }
+        this->emojiImages.insert(id, new QImage(emojiImage));
+    }
+    if (size) {
+        *size = emojiImage.size();
+    }
+    return emojiImage;
+}
+
+void EmojiImageProvider::scheduleSave()
+{
+    // Emoji usually come in bursts while scrolling, the atlases are written once things calm down
+    this->saveTimer.start();
+}
+
+void EmojiImageProvider::saveAtlases()
+{
+    this->writeModifiedAtlases(true);
+}
+
+EmojiImageProvider::EmojiAtlas &EmojiImageProvider::getAtlas(const int &pixelSize)
+{
+    QHash<int, EmojiAtlas>::iterator existingAtlas = this->atlases.find(pixelSize);
+    if (existingAtlas != this->atlases.end()) {
+        return existingAtlas.value();
+    }
+    EmojiAtlas &atlas = this->atlases[pixelSize];
+    QFile indexFile(this->getAtlasPath(pixelSize, "txt"));
+    if (!indexFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return atlas;
+    }
+    QStringList fileNames = QString::fromUtf8(indexFile.readAll()).split("\n", QString::SkipEmptyParts);
+    if (fileNames.isEmpty() || fileNames.takeFirst() != ATLAS_FORMAT_VERSION) {
+        return atlas;
+    }
+    QImage atlasImage(this->getAtlasPath(pixelSize, "png"));
+    int atlasRows = (fileNames.size() + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+    if (atlasImage.isNull() || atlasImage.width() != ATLAS_COLUMNS * pixelSize || atlasImage.height() < atlasRows * pixelSize) {
+        qDebug() << "[EmojiImageProvider] Ignoring damaged emoji atlas for size" << pixelSize;
+        return atlas;
+    }
+    atlas.image = atlasImage.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    atlas.fileNames = fileNames;
+    for (int i = 0; i < fileNames.size(); i++) {
+        atlas.slotIndexes.insert(fileNames.at(i), i);
+    }
+    qDebug() << "[EmojiImageProvider] Loaded emoji atlas for size" << pixelSize << "with" << fileNames.size() << "emoji";
+    return atlas;
+}
+
+QImage EmojiImageProvider::rasterizeEmoji(const QString &fileName, const int &pixelSize) const
+{
+    QImageReader emojiReader(SailfishApp::pathTo("qml/js/emoji/" + fileName + ".svg").toLocalFile());
+    // SVGs are rendered directly at the target size instead of scaling a bitmap
+    emojiReader.setScaledSize(QSize(pixelSize, pixelSize));
+    QImage emojiImage = emojiReader.read();
+    if (emojiImage.isNull()) {
+        qDebug() << "[EmojiImageProvider] Unable to rasterize emoji" << fileName << emojiReader.errorString();
+        return emojiImage;
+    }
+    return emojiImage.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+void EmojiImageProvider::addToAtlas(EmojiAtlas &atlas, const QString &fileName, const QImage &emojiImage, const int &pixelSize)
+{
+    int slotIndex = atlas.fileNames.size();
+    int requiredHeight = (slotIndex / ATLAS_COLUMNS + 1) * pixelSize;
+    if (atlas.image.height() < requiredHeight) {
+        QImage grownImage(ATLAS_COLUMNS * pixelSize, requiredHeight + (ATLAS_GROWTH_ROWS - 1) * pixelSize, QImage::Format_ARGB32_Premultiplied);
+        grownImage.fill(Qt::transparent);
+        if (!atlas.image.isNull()) {
+            QPainter atlasPainter(&grownImage);
+            atlasPainter.setCompositionMode(QPainter::CompositionMode_Source);
+            atlasPainter.drawImage(0, 0, atlas.image);
+        }
+        atlas.image = grownImage;
+    }
+    QPainter atlasPainter(&atlas.image);
+    atlasPainter.setCompositionMode(QPainter::CompositionMode_Source);
+    atlasPainter.drawImage((slotIndex % ATLAS_COLUMNS) * pixelSize, (slotIndex / ATLAS_COLUMNS) * pixelSize, emojiImage);
+    atlasPainter.end();
+    atlas.fileNames.append(fileName);
+    atlas.slotIndexes.insert(fileName, slotIndex);
+    atlas.modified = true;
+    QMetaObject::invokeMethod(this, "scheduleSave", Qt::QueuedConnection);
+}
+
+QString EmojiImageProvider::getAtlasPath(const int &pixelSize, const QString &suffix) const
+{
+    return this->atlasDirectory + "/atlas-" + QString::number(pixelSize) + "." + suffix;
+}
+
+void EmojiImageProvider::writeModifiedAtlases(const bool &inBackground)
+{
+    // Only copies are taken while locked, encoding the PNGs would block the image loader threads for too long
+    QList<AtlasWriter *> atlasWriters;
+    this->atlasMutex.lock();
+    QMutableHashIterator<int, EmojiAtlas> atlasIterator(this->atlases);
+    while (atlasIterator.hasNext()) {
+        atlasIterator.next();
+        EmojiAtlas &atlas = atlasIterator.value();
+        if (atlas.modified) {
+            int pixelSize = atlasIterator.key();
+            atlasWriters.append(new AtlasWriter(this->getAtlasPath(pixelSize, "png"), this->getAtlasPath(pixelSize, "txt"), atlas.image, atlas.fileNames));
+            atlas.modified = false;
+        }
+    }
+    this->atlasMutex.unlock();
+    if (atlasWriters.isEmpty()) {
+        return;
+    }
+    QDir().mkpath(this->atlasDirectory);
+    QListIterator<AtlasWriter *> atlasWriterIterator(atlasWriters);
+    while (atlasWriterIterator.hasNext()) {
+        AtlasWriter *atlasWriter = atlasWriterIterator.next();
+        if (inBackground) {
+            this->atlasWriterPool.start(atlasWriter);
+        } else {
+            atlasWriter->run();
+            delete atlasWriter;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EMOJIIMAGEPROVIDER_H
+#define EMOJIIMAGEPROVIDER_H
+
+#include <QObject>
+#include <QQuickImageProvider>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+// Serves image://emoji/<size>/<file name>, every emoji is rasterized once per size and kept in an atlas on disk
+class EmojiImageProvider : public QObject, public QQuickImageProvider
+{
+    Q_OBJECT
+public:
+    EmojiImageProvider();
+    ~EmojiImageProvider() override;
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+private slots:
+    void scheduleSave();
+    void saveAtlases();
+
+private:
+    struct EmojiAtlas {
+        QImage image;
+        QStringList fileNames;
+        QHash<QString, int> slotIndexes;
+        bool modified = false;
+    };
+
+    QHash<int, EmojiAtlas> atlases;
+    QCache<QString, QImage> emojiImages;
+    QMutex atlasMutex;
+    QTimer saveTimer;
+    QThreadPool atlasWriterPool;
+    QString atlasDirectory;
+
+    EmojiAtlas &getAtlas(const int &pixelSize);
+    QImage rasterizeEmoji(const QString &fileName, const int &pixelSize) const;
+    void addToAtlas(EmojiAtlas &atlas, const QString &fileName, const QImage &emojiImage, const int &pixelSize);
+    QString getAtlasPath(const int &pixelSize, const QString &suffix) const;
+    void writeModifiedAtlases(const bool &inBackground);
+};
+
+#endif // EMOJIIMAGEPROVIDER_H
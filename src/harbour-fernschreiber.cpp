@@ -31,8 +31,13 @@
 
 #include "tdlibwrapper.h"
 #include "chatlistmodel.h"
+#include "chatlistfiltermodel.h"
 #include "chatmodel.h"
 #include "notificationmanager.h"
+#include "unreadaggregator.h"
+#include "relativetimeclock.h"
+#include "emojiengine.h"
+#include "emojiimageprovider.h"
 #include "dbusadaptor.h"
 
 int main(int argc, char *argv[])
@@ -49,12 +54,26 @@ int main(int argc, char *argv[])
     DBusAdaptor *dBusAdaptor = tdLibWrapper->getDBusAdaptor();
     context->setContextProperty("dBusAdaptor", dBusAdaptor);
 
-    ChatListModel chatListModel(tdLibWrapper);
+    RelativeTimeClock relativeTimeClock;
+    context->setContextProperty("relativeTimeClock", &relativeTimeClock);
+
+    EmojiEngine emojiEngine;
+    context->setContextProperty("emojiEngine", &emojiEngine);
+    view->engine()->addImageProvider("emoji", new EmojiImageProvider());
+
+    ChatListModel chatListModel(tdLibWrapper, &relativeTimeClock, &emojiEngine);
     context->setContextProperty("chatListModel", &chatListModel);
 
-    ChatModel chatModel(tdLibWrapper);
+    ChatListFilterModel chatListFilterModel(&chatListModel);
+    context->setContextProperty("chatListFilterModel", &chatListFilterModel);
+    qmlRegisterUncreatableType<ChatListFilterModel>("WerkWolf.Fernschreiber", 1, 0, "ChatListFilter", "Use the chatListFilterModel context property");
+
+    ChatModel chatModel(tdLibWrapper, &relativeTimeClock, &emojiEngine);
     context->setContextProperty("chatModel", &chatModel);
 
+    UnreadAggregator unreadAggregator(tdLibWrapper);
+    context->setContextProperty("unreadAggregator", &unreadAggregator);
+
     NotificationManager notificationManager(tdLibWrapper);
     context->setContextProperty("notificationManager", &notificationManager);
 
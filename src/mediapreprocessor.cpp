@@ -0,0 +1,123 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mediapreprocessor.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QStandardPaths>
+
+namespace {
+
+    // Telegram doesn't keep photos larger than this anyway
+    const int MAXIMUM_PHOTO_SIZE = 1280;
+    const int PHOTO_QUALITY = 87;
+    const int THUMBNAIL_SIZE = 90;
+    const int THUMBNAIL_QUALITY = 80;
+    // Leftovers of photos whose sending was interrupted, younger ones may still be uploaded by TDLib
+    const qint64 UPLOAD_FILE_MAXIMUM_AGE = 86400;
+
+}
+
+MediaPreprocessor::MediaPreprocessor(QObject *parent) : QObject(parent)
+{
+    this->uploadDirectoryPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/upload";
+    this->preparedFileCount = 0;
+}
+
+MediaPreprocessor::~MediaPreprocessor()
+{
+    qDebug() << "[MediaPreprocessor] Destroying myself...";
+}
+
+void MediaPreprocessor::initializeUploadDirectory()
+{
+    // Called on the worker thread, before any photo is prepared
+    QDir uploadDirectory(this->uploadDirectoryPath);
+    if (!uploadDirectory.exists()) {
+        uploadDirectory.mkpath(this->uploadDirectoryPath);
+    }
+    QDateTime oldestKeptFileTime = QDateTime::currentDateTime().addSecs(-UPLOAD_FILE_MAXIMUM_AGE);
+    QListIterator<QFileInfo> uploadFileIterator(uploadDirectory.entryInfoList(QDir::Files));
+    while (uploadFileIterator.hasNext()) {
+        QFileInfo uploadFile = uploadFileIterator.next();
+        if (uploadFile.lastModified() < oldestKeptFileTime) {
+            qDebug() << "[MediaPreprocessor] Removing stale upload file" << uploadFile.fileName();
+            QFile::remove(uploadFile.absoluteFilePath());
+        }
+    }
+}
+
+void MediaPreprocessor::preparePhoto(const QVariantMap &photoRequest)
+{
+    QElapsedTimer preparationTimer;
+    preparationTimer.start();
+    QVariantMap preparedPhotoRequest = photoRequest;
+    QString filePath = photoRequest.value("file_path").toString();
+    preparedPhotoRequest.insert("path", filePath);
+
+    QImageReader imageReader(filePath);
+    imageReader.setAutoTransform(true);
+    QSize originalSize = imageReader.size();
+    if (originalSize.isValid() && (originalSize.width() > MAXIMUM_PHOTO_SIZE || originalSize.height() > MAXIMUM_PHOTO_SIZE)) {
+        // Decoders like the one for JPEG are able to skip most of the work for smaller sizes
+        imageReader.setScaledSize(originalSize.scaled(MAXIMUM_PHOTO_SIZE, MAXIMUM_PHOTO_SIZE, Qt::KeepAspectRatio));
+    }
+    QImage photo = imageReader.read();
+    if (photo.isNull()) {
+        qWarning() << "[MediaPreprocessor] Unable to read photo" << filePath << imageReader.errorString() << ", sending it unchanged";
+        emit photoPrepared(preparedPhotoRequest);
+        return;
+    }
+
+    // Only the files created here are removed again once the photo is sent
+    QStringList uploadFiles;
+    QString photoPath = this->createUploadFilePath("jpg");
+    if (photo.save(photoPath, "JPG", PHOTO_QUALITY)) {
+        preparedPhotoRequest.insert("path", photoPath);
+        uploadFiles.append(photoPath);
+    } else {
+        qWarning() << "[MediaPreprocessor] Unable to write" << photoPath << ", sending the original photo";
+    }
+    preparedPhotoRequest.insert("width", photo.width());
+    preparedPhotoRequest.insert("height", photo.height());
+
+    QImage thumbnail = photo.scaled(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    QString thumbnailPath = this->createUploadFilePath("jpg");
+    if (thumbnail.save(thumbnailPath, "JPG", THUMBNAIL_QUALITY)) {
+        preparedPhotoRequest.insert("thumbnail_path", thumbnailPath);
+        preparedPhotoRequest.insert("thumbnail_width", thumbnail.width());
+        preparedPhotoRequest.insert("thumbnail_height", thumbnail.height());
+        uploadFiles.append(thumbnailPath);
+    }
+    preparedPhotoRequest.insert("upload_files", uploadFiles);
+    qDebug() << "[MediaPreprocessor] Photo" << filePath << "prepared in" << preparationTimer.elapsed() << "ms, size" << originalSize << "->" << photo.size();
+    emit photoPrepared(preparedPhotoRequest);
+}
+
+QString MediaPreprocessor::createUploadFilePath(const QString &suffix)
+{
+    this->preparedFileCount++;
+    return this->uploadDirectoryPath + "/" + QString::number(QDateTime::currentMSecsSinceEpoch()) + "-" + QString::number(this->preparedFileCount) + "." + suffix;
+}
@@ -0,0 +1,48 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEDIAPREPROCESSOR_H
+#define MEDIAPREPROCESSOR_H
+
+#include <QObject>
+#include <QVariantMap>
+
+// Prepares outgoing media for sending, lives on a worker thread of TDLibWrapper
+class MediaPreprocessor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MediaPreprocessor(QObject *parent = nullptr);
+    ~MediaPreprocessor() override;
+
+signals:
+    void photoPrepared(const QVariantMap &photoRequest);
+
+public slots:
+    void preparePhoto(const QVariantMap &photoRequest);
+    void initializeUploadDirectory();
+
+private:
+    QString uploadDirectoryPath;
+    int preparedFileCount;
+
+    QString createUploadFilePath(const QString &suffix);
+};
+
+#endif // MEDIAPREPROCESSOR_H
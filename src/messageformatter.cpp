@@ -0,0 +1,274 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "messageformatter.h"
+#include <QDateTime>
+#include <QLocale>
+#include <QVector>
+#include <algorithm>
+
+namespace {
+
+    struct TextEntityTag {
+        int offset;
+        // Tags at the same offset: closing ones first, then the outermost opening one
+        int precedence;
+        int sequence;
+        QString tag;
+    };
+
+    bool compareTextEntityTags(const TextEntityTag &tag1, const TextEntityTag &tag2)
+    {
+        if (tag1.offset != tag2.offset) {
+            return tag1.offset < tag2.offset;
+        }
+        if (tag1.precedence != tag2.precedence) {
+            return tag1.precedence < tag2.precedence;
+        }
+        return tag1.sequence < tag2.sequence;
+    }
+
+    bool isCollapsibleSpace(const QString &text, const int &position)
+    {
+        if (position < 0 || position >= text.length()) {
+            return false;
+        }
+        const QChar currentCharacter = text.at(position);
+        return currentCharacter.isSpace() && currentCharacter != '\n' && currentCharacter != '\r';
+    }
+
+}
+
+QString MessageFormatter::getUserName(const QVariantMap &userInformation)
+{
+    QString firstName = userInformation.value("first_name").toString();
+    QString lastName = userInformation.value("last_name").toString();
+    return QString(firstName + " " + lastName).trimmed();
+}
+
+QString MessageFormatter::getMessageText(const QVariantMap &message)
+{
+    QVariantMap content = message.value("content").toMap();
+    QString contentType = content.value("@type").toString();
+    QString captionText = content.value("caption").toMap().value("text").toString();
+
+    if (contentType == "messageText") {
+        return content.value("text").toMap().value("text").toString();
+    }
+    if (contentType == "messageSticker") {
+        return tr("Sticker: %1").arg(content.value("sticker").toMap().value("emoji").toString());
+    }
+    if (contentType == "messagePhoto") {
+        return captionText.isEmpty() ? tr("sent a picture") : tr("Picture: %1").arg(captionText);
+    }
+    if (contentType == "messageVideo") {
+        return captionText.isEmpty() ? tr("sent a video") : tr("Video: %1").arg(captionText);
+    }
+    if (contentType == "messageAnimation") {
+        return captionText.isEmpty() ? tr("sent an animation") : tr("Animation: %1").arg(captionText);
+    }
+    if (contentType == "messageAudio") {
+        return captionText.isEmpty() ? tr("sent an audio") : tr("Audio: %1").arg(captionText);
+    }
+    if (contentType == "messageVoiceNote") {
+        return captionText.isEmpty() ? tr("sent a voice note") : tr("Voice Note: %1").arg(captionText);
+    }
+    if (contentType == "messageDocument") {
+        QString fileName = content.value("document").toMap().value("file_name").toString();
+        return fileName.isEmpty() ? tr("sent a document") : tr("Document: %1").arg(fileName);
+    }
+    if (contentType == "messageLocation") {
+        return tr("sent a location");
+    }
+    if (contentType == "messageContactRegistered") {
+        return tr("has registered with Telegram");
+    }
+    if (contentType == "messageChatJoinByLink") {
+        return tr("joined this chat");
+    }
+    if (contentType == "messageChatAddMembers") {
+        return tr("was added to this chat");
+    }
+    if (contentType == "messageChatDeleteMember") {
+        return tr("left this chat");
+    }
+    return tr("Unsupported message: %1").arg(contentType.mid(7));
+}
+
+QString MessageFormatter::getMessageRichText(const QVariantMap &message)
+{
+    QVariantMap content = message.value("content").toMap();
+    QString contentType = content.value("@type").toString();
+
+    if (contentType == "messageText") {
+        return formatText(content.value("text").toMap());
+    }
+    if (contentType == "messagePhoto" || contentType == "messageVideo" || contentType == "messageAnimation" || contentType == "messageAudio" || contentType == "messageVoiceNote") {
+        return formatText(content.value("caption").toMap());
+    }
+    if (contentType == "messageSticker") {
+        return QString();
+    }
+    if (contentType == "messageDocument") {
+        return escapeHtml(content.value("document").toMap().value("file_name").toString());
+    }
+    return escapeHtml(getMessageText(message));
+}
+
+QString MessageFormatter::formatText(const QVariantMap &formattedText)
+{
+    // Entity offsets are counted in UTF-16 code units, just like QString indexes
+    const QString text = formattedText.value("text").toString();
+    QVector<TextEntityTag> tags;
+    QListIterator<QVariant> entitiesIterator(formattedText.value("entities").toList());
+    while (entitiesIterator.hasNext()) {
+        QVariantMap entity = entitiesIterator.next().toMap();
+        if (entity.value("@type").toString() != "textEntity") {
+            continue;
+        }
+        int offset = qBound(0, entity.value("offset").toInt(), text.length());
+        int end = qBound(offset, offset + entity.value("length").toInt(), text.length());
+        QVariantMap entityType = entity.value("type").toMap();
+        QString entityTypeName = entityType.value("@type").toString();
+        QString entityText = escapeHtml(text.mid(offset, end - offset));
+        QString openingTag;
+        QString closingTag = "</a>";
+        if (entityTypeName == "textEntityTypeBold") {
+            openingTag = "<b>";
+            closingTag = "</b>";
+        } else if (entityTypeName == "textEntityTypeItalic") {
+            openingTag = "<i>";
+            closingTag = "</i>";
+        } else if (entityTypeName == "textEntityTypeUnderline") {
+            openingTag = "<u>";
+            closingTag = "</u>";
+        } else if (entityTypeName == "textEntityTypeCode" || entityTypeName == "textEntityTypePre" || entityTypeName == "textEntityTypePreCode") {
+            openingTag = "<pre>";
+            closingTag = "</pre>";
+        } else if (entityTypeName == "textEntityTypeUrl") {
+            openingTag = "<a href=\"" + entityText + "\">";
+        } else if (entityTypeName == "textEntityTypeEmailAddress") {
+            openingTag = "<a href=\"mailto:" + entityText + "\">";
+        } else if (entityTypeName == "textEntityTypeMention") {
+            openingTag = "<a href=\"user:" + entityText + "\">";
+        } else if (entityTypeName == "textEntityTypeMentionName") {
+            openingTag = "<a href=\"userId://" + entityType.value("user_id").toString() + "\">";
+        } else if (entityTypeName == "textEntityTypePhoneNumber") {
+            openingTag = "<a href=\"tel:" + entityText + "\">";
+        } else if (entityTypeName == "textEntityTypeTextUrl") {
+            openingTag = "<a href=\"" + escapeHtml(entityType.value("url").toString()) + "\">";
+        } else {
+            continue;
+        }
+        // Longer entities open earlier and close later, so nested tags stay balanced
+        int sequence = tags.size();
+        tags.append({ offset, 0x40000000 - end, sequence, openingTag });
+        tags.append({ end, -offset - 0x40000000, -sequence, closingTag });
+    }
+    std::sort(tags.begin(), tags.end(), compareTextEntityTags);
+
+    QString richText;
+    richText.reserve(text.length() + text.length() / 4 + tags.size() * 8);
+    int tagIndex = 0;
+    for (int i = 0; i <= text.length(); i++) {
+        while (tagIndex < tags.size() && tags.at(tagIndex).offset == i) {
+            richText.append(tags.at(tagIndex).tag);
+            tagIndex++;
+        }
+        if (i == text.length()) {
+            break;
+        }
+        const QChar currentCharacter = text.at(i);
+        switch (currentCharacter.unicode()) {
+        case '\r':
+            if (i + 1 < text.length() && text.at(i + 1) == '\n') {
+                break;
+            }
+            richText.append(currentCharacter);
+            break;
+        case '\n':
+            richText.append("<br>");
+            break;
+        case '<':
+            richText.append("&lt;");
+            break;
+        case '>':
+            richText.append("&gt;");
+            break;
+        case '&':
+            richText.append("&amp;");
+            break;
+        case '"':
+            richText.append("&quot;");
+            break;
+        default:
+            // Runs of whitespace would be collapsed by the text layout otherwise
+            if (isCollapsibleSpace(text, i) && (isCollapsibleSpace(text, i - 1) || isCollapsibleSpace(text, i + 1))) {
+                richText.append("&nbsp;");
+            } else {
+                richText.append(currentCharacter);
+            }
+        }
+    }
+    return richText;
+}
+
+QString MessageFormatter::escapeHtml(const QString &text)
+{
+    QString escapedText;
+    escapedText.reserve(text.length());
+    for (int i = 0; i < text.length(); i++) {
+        const QChar currentCharacter = text.at(i);
+        switch (currentCharacter.unicode()) {
+        case '<':
+            escapedText.append("&lt;");
+            break;
+        case '>':
+            escapedText.append("&gt;");
+            break;
+        case '&':
+            escapedText.append("&amp;");
+            break;
+        case '"':
+            escapedText.append("&quot;");
+            break;
+        default:
+            escapedText.append(currentCharacter);
+        }
+    }
+    return escapedText;
+}
+
+QString MessageFormatter::getDateTimeElapsed(const qint64 &timestamp)
+{
+    qint64 elapsedSeconds = QDateTime::currentMSecsSinceEpoch() / 1000 - timestamp;
+    if (elapsedSeconds < 60) {
+        return tr("now");
+    }
+    if (elapsedSeconds < 3600) {
+        return tr("%n minute(s) ago", "", static_cast<int>(elapsedSeconds / 60));
+    }
+    if (elapsedSeconds < 86400) {
+        return tr("%n hour(s) ago", "", static_cast<int>(elapsedSeconds / 3600));
+    }
+    if (elapsedSeconds < 604800) {
+        return tr("%n day(s) ago", "", static_cast<int>(elapsedSeconds / 86400));
+    }
+    return QLocale().toString(QDateTime::fromMSecsSinceEpoch(timestamp * 1000).date(), QLocale::ShortFormat);
+}
@@ -0,0 +1,39 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MESSAGEFORMATTER_H
+#define MESSAGEFORMATTER_H
+
+#include <QObject>
+#include <QVariantMap>
+
+// Native counterparts of the presentation helpers in qml/js/functions.js
+class MessageFormatter : public QObject
+{
+    Q_OBJECT
+public:
+    static QString getUserName(const QVariantMap &userInformation);
+    static QString getMessageText(const QVariantMap &message);
+    static QString getMessageRichText(const QVariantMap &message);
+    static QString formatText(const QVariantMap &formattedText);
+    static QString escapeHtml(const QString &text);
+    static QString getDateTimeElapsed(const qint64 &timestamp);
+};
+
+#endif // MESSAGEFORMATTER_H
@@ -0,0 +1,184 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "messageoutbox.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QStandardPaths>
+
+const qint64 MessageOutbox::FIRST_LOCAL_MESSAGE_ID = Q_INT64_C(1) << 52;
+
+MessageOutbox::MessageOutbox(QObject *parent) : QObject(parent)
+{
+    this->nextLocalMessageId = FIRST_LOCAL_MESSAGE_ID;
+    QString outboxDirectoryPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir outboxDirectory(outboxDirectoryPath);
+    if (!outboxDirectory.exists()) {
+        outboxDirectory.mkpath(outboxDirectoryPath);
+    }
+    this->outboxFilePath = outboxDirectoryPath + "/outbox.json";
+    this->load();
+}
+
+MessageOutbox::~MessageOutbox()
+{
+    qDebug() << "[MessageOutbox] Destroying myself...";
+}
+
+QVariantMap MessageOutbox::addMessage(const QString &chatId, const QString &senderUserId, const QString &text, const QString &replyToMessageId)
+{
+    QVariantMap formattedText;
+    formattedText.insert("@type", "formattedText");
+    formattedText.insert("text", text);
+    formattedText.insert("entities", QVariantList());
+    QVariantMap content;
+    content.insert("@type", "messageText");
+    content.insert("text", formattedText);
+    QVariantMap sendingState;
+    sendingState.insert("@type", "messageSendingStatePending");
+
+    QVariantMap message;
+    message.insert("@type", "message");
+    message.insert("id", this->nextLocalMessageId++);
+    message.insert("chat_id", chatId);
+    message.insert("sender_user_id", senderUserId);
+    message.insert("is_outgoing", true);
+    message.insert("date", QDateTime::currentMSecsSinceEpoch() / 1000);
+    message.insert("reply_to_message_id", replyToMessageId.toLongLong());
+    message.insert("content", content);
+    message.insert("sending_state", sendingState);
+
+    OutboxEntry entry;
+    entry.message = message;
+    entry.sent = false;
+    this->entries.append(entry);
+    qDebug() << "[MessageOutbox] Message added to outbox, local ID" << message.value("id").toString();
+    this->save();
+    return message;
+}
+
+QVariantList MessageOutbox::takeUnsentRequests()
+{
+    QVariantList requests;
+    QList<OutboxEntry>::iterator entry;
+    for (entry = this->entries.begin(); entry != this->entries.end(); ++entry) {
+        if (entry->sent) {
+            continue;
+        }
+        QVariantMap requestObject;
+        requestObject.insert("@type", "sendMessage");
+        requestObject.insert("chat_id", entry->message.value("chat_id"));
+        if (entry->message.value("reply_to_message_id").toLongLong() != 0) {
+            requestObject.insert("reply_to_message_id", entry->message.value("reply_to_message_id"));
+        }
+        QVariantMap inputMessageContent;
+        inputMessageContent.insert("@type", "inputMessageText");
+        inputMessageContent.insert("text", entry->message.value("content").toMap().value("text"));
+        requestObject.insert("input_message_content", inputMessageContent);
+        // The answer to the request names the outbox message it belongs to
+        requestObject.insert("@extra", "sendMessage:" + entry->message.value("id").toString());
+        requests.append(requestObject);
+        entry->sent = true;
+    }
+    if (!requests.isEmpty()) {
+        this->save();
+    }
+    return requests;
+}
+
+QVariantMap MessageOutbox::takeMessage(const QString &localMessageId)
+{
+    for (int i = 0; i < this->entries.size(); i++) {
+        if (this->entries.at(i).message.value("id").toString() == localMessageId) {
+            QVariantMap message = this->entries.takeAt(i).message;
+            qDebug() << "[MessageOutbox] Message" << localMessageId << "removed from outbox";
+            this->save();
+            return message;
+        }
+    }
+    return QVariantMap();
+}
+
+bool MessageOutbox::hasMessagesInFlight(const QString &chatId) const
+{
+    QListIterator<OutboxEntry> entryIterator(this->entries);
+    while (entryIterator.hasNext()) {
+        const OutboxEntry &entry = entryIterator.next();
+        if (entry.sent && entry.message.value("chat_id").toString() == chatId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QVariantList MessageOutbox::getMessages(const QString &chatId) const
+{
+    QVariantList messages;
+    QListIterator<OutboxEntry> entryIterator(this->entries);
+    while (entryIterator.hasNext()) {
+        const OutboxEntry &entry = entryIterator.next();
+        if (entry.message.value("chat_id").toString() == chatId) {
+            messages.append(entry.message);
+        }
+    }
+    return messages;
+}
+
+void MessageOutbox::load()
+{
+    QFile outboxFile(this->outboxFilePath);
+    if (!outboxFile.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    // Messages handed to TDLib before are in its own database and sent from there, only the others are kept
+    QListIterator<QVariant> entryIterator(QJsonDocument::fromJson(outboxFile.readAll()).toVariant().toList());
+    while (entryIterator.hasNext()) {
+        QVariantMap storedEntry = entryIterator.next().toMap();
+        OutboxEntry entry;
+        entry.message = storedEntry.value("message").toMap();
+        entry.sent = false;
+        this->nextLocalMessageId = qMax(this->nextLocalMessageId, entry.message.value("id").toLongLong() + 1);
+        if (!storedEntry.value("sent").toBool()) {
+            this->entries.append(entry);
+        }
+    }
+    qDebug() << "[MessageOutbox] Loaded" << this->entries.size() << "unsent messages";
+}
+
+void MessageOutbox::save()
+{
+    QVariantList storedEntries;
+    QListIterator<OutboxEntry> entryIterator(this->entries);
+    while (entryIterator.hasNext()) {
+        const OutboxEntry &entry = entryIterator.next();
+        QVariantMap storedEntry;
+        storedEntry.insert("message", entry.message);
+        storedEntry.insert("sent", entry.sent);
+        storedEntries.append(storedEntry);
+    }
+    QFile outboxFile(this->outboxFilePath);
+    if (!outboxFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "[MessageOutbox] Unable to write outbox" << this->outboxFilePath;
+        return;
+    }
+    outboxFile.write(QJsonDocument::fromVariant(storedEntries).toJson(QJsonDocument::Compact));
+}
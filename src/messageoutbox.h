@@ -0,0 +1,58 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MESSAGEOUTBOX_H
+#define MESSAGEOUTBOX_H
+
+#include <QObject>
+#include <QVariantList>
+#include <QVariantMap>
+
+// Text messages which were written but not yet accepted by TDLib, kept on disk until they are
+class MessageOutbox : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MessageOutbox(QObject *parent = nullptr);
+    ~MessageOutbox() override;
+
+    // Far beyond the IDs assigned by TDLib, so local messages are always sorted in after the known ones
+    static const qint64 FIRST_LOCAL_MESSAGE_ID;
+
+    QVariantMap addMessage(const QString &chatId, const QString &senderUserId, const QString &text, const QString &replyToMessageId);
+    QVariantList takeUnsentRequests();
+    QVariantMap takeMessage(const QString &localMessageId);
+    bool hasMessagesInFlight(const QString &chatId) const;
+    QVariantList getMessages(const QString &chatId) const;
+
+private:
+    struct OutboxEntry {
+        QVariantMap message;
+        bool sent;
+    };
+
+    QList<OutboxEntry> entries;
+    qint64 nextLocalMessageId;
+    QString outboxFilePath;
+
+    void load();
+    void save();
+};
+
+#endif // MESSAGEOUTBOX_H
@@ -0,0 +1,76 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "relativetimeclock.h"
+#include <QGuiApplication>
+#include <QDateTime>
+#include <QDebug>
+
+namespace {
+
+    const qint64 MINUTE_MSECS = 60000;
+
+}
+
+RelativeTimeClock::RelativeTimeClock(QObject *parent) : QObject(parent)
+{
+    this->lastMinute = QDateTime::currentMSecsSinceEpoch() / MINUTE_MSECS;
+    this->minuteTimer.setSingleShot(true);
+    this->minuteTimer.setTimerType(Qt::PreciseTimer);
+    connect(&this->minuteTimer, SIGNAL(timeout()), this, SLOT(handleMinuteTimeout()));
+    connect(qGuiApp, SIGNAL(applicationStateChanged(Qt::ApplicationState)), this, SLOT(handleApplicationStateChanged(Qt::ApplicationState)));
+    if (qGuiApp->applicationState() == Qt::ApplicationActive) {
+        this->scheduleNextMinute();
+    }
+}
+
+RelativeTimeClock::~RelativeTimeClock()
+{
+    qDebug() << "[RelativeTimeClock] Destroying myself...";
+}
+
+void RelativeTimeClock::handleMinuteTimeout()
+{
+    this->lastMinute = QDateTime::currentMSecsSinceEpoch() / MINUTE_MSECS;
+    emit minuteChanged();
+    this->scheduleNextMinute();
+}
+
+void RelativeTimeClock::handleApplicationStateChanged(Qt::ApplicationState applicationState)
+{
+    if (applicationState == Qt::ApplicationActive) {
+        qDebug() << "[RelativeTimeClock] Application active, resuming minute tick";
+        // Texts are outdated if a minute boundary passed while we were paused
+        if (QDateTime::currentMSecsSinceEpoch() / MINUTE_MSECS != this->lastMinute) {
+            this->handleMinuteTimeout();
+        } else {
+            this->scheduleNextMinute();
+        }
+    } else if (this->minuteTimer.isActive()) {
+        qDebug() << "[RelativeTimeClock] Application not active, pausing minute tick";
+        this->minuteTimer.stop();
+    }
+}
+
+void RelativeTimeClock::scheduleNextMinute()
+{
+    // Aligned to the wall clock, so that all texts switch together when the minute changes
+    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+    this->minuteTimer.start(static_cast<int>(MINUTE_MSECS - (currentTime % MINUTE_MSECS)));
+}
@@ -0,0 +1,48 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RELATIVETIMECLOCK_H
+#define RELATIVETIMECLOCK_H
+
+#include <QObject>
+#include <QTimer>
+
+// Shared minute tick for all relative time texts, only running while the app is in the foreground
+class RelativeTimeClock : public QObject
+{
+    Q_OBJECT
+public:
+    explicit RelativeTimeClock(QObject *parent = nullptr);
+    ~RelativeTimeClock() override;
+
+signals:
+    void minuteChanged();
+
+private slots:
+    void handleMinuteTimeout();
+    void handleApplicationStateChanged(Qt::ApplicationState applicationState);
+
+private:
+    QTimer minuteTimer;
+    qint64 lastMinute;
+
+    void scheduleNextMinute();
+};
+
+#endif // RELATIVETIMECLOCK_H
@@ -75,11 +75,19 @@ void TDLibReceiver::processReceivedDocument(const QJsonDocument &receivedJsonDoc
     if (objectTypeName == "updateNewMessage") { this->processUpdateNewMessage(receivedInformation); }
     if (objectTypeName == "message") { this->processMessage(receivedInformation); }
     if (objectTypeName == "updateMessageSendSucceeded") { this->processMessageSendSucceeded(receivedInformation); }
+    if (objectTypeName == "updateMessageSendFailed") { this->processMessageSendFailed(receivedInformation); }
     if (objectTypeName == "updateActiveNotifications") { this->processUpdateActiveNotifications(receivedInformation); }
     if (objectTypeName == "updateNotificationGroup") { this->processUpdateNotificationGroup(receivedInformation); }
     if (objectTypeName == "updateChatNotificationSettings") { this->processUpdateChatNotificationSettings(receivedInformation); }
     if (objectTypeName == "updateMessageContent") { this->processUpdateMessageContent(receivedInformation); }
+    if (objectTypeName == "updateMessageEdited") { this->processUpdateMessageEdited(receivedInformation); }
+    if (objectTypeName == "updateMessageViews") { this->processUpdateMessageViews(receivedInformation); }
     if (objectTypeName == "updateDeleteMessages") { this->processUpdateDeleteMessages(receivedInformation); }
+    if (objectTypeName == "updateChatTitle") { this->processUpdateChatTitle(receivedInformation); }
+    if (objectTypeName == "updateChatUnreadMentionCount") { this->processUpdateChatUnreadMentionCount(receivedInformation); }
+    if (objectTypeName == "updateMessageMentionRead") { this->processUpdateChatUnreadMentionCount(receivedInformation); }
+    if (objectTypeName == "updateChatDraftMessage") { this->processUpdateChatDraftMessage(receivedInformation); }
+    if (objectTypeName == "error") { this->processError(receivedInformation); }
 }
 
 void TDLibReceiver::processUpdateOption(const QVariantMap &receivedInformation)
@@ -216,6 +224,13 @@ void TDLibReceiver::processChatOnlineMemberCountUpdated(const QVariantMap &recei
 
 void TDLibReceiver::processMessages(const QVariantMap &receivedInformation)
 {
+    // Explicitly requested messages are tagged, so they don't end up in the chat history
+    QString extra = receivedInformation.value("@extra").toString();
+    if (extra.startsWith("getMessages:")) {
+        qDebug() << "[TDLibReceiver] Received requested messages" << extra;
+        emit messagesFetched(extra.mid(12), receivedInformation.value("messages").toList());
+        return;
+    }
     qDebug() << "[TDLibReceiver] Received new messages, amount: " << receivedInformation.value("total_count").toString();
     emit messagesReceived(receivedInformation.value("messages").toList());
 }
@@ -231,6 +246,12 @@ void TDLibReceiver::processMessage(const QVariantMap &receivedInformation)
 {
     QString chatId = receivedInformation.value("chat_id").toString();
     QString messageId = receivedInformation.value("id").toString();
+    QString extra = receivedInformation.value("@extra").toString();
+    if (extra.startsWith("sendMessage:")) {
+        qDebug() << "[TDLibReceiver] Received sent message " << chatId << messageId << extra;
+        emit sentMessageReceived(extra.mid(12), receivedInformation);
+        return;
+    }
     qDebug() << "[TDLibReceiver] Received message " << chatId << messageId;
     emit messageInformation(messageId, receivedInformation);
 }
@@ -244,6 +265,15 @@ void TDLibReceiver::processMessageSendSucceeded(const QVariantMap &receivedInfor
     emit messageSendSucceeded(messageId, oldMessageId, message);
 }
 
+void TDLibReceiver::processMessageSendFailed(const QVariantMap &receivedInformation)
+{
+    QString oldMessageId = receivedInformation.value("old_message_id").toString();
+    QVariantMap message = receivedInformation.value("message").toMap();
+    QString messageId = message.value("id").toString();
+    qDebug() << "[TDLibReceiver] Message send failed " << messageId << oldMessageId << receivedInformation.value("error_message").toString();
+    emit messageSendFailed(messageId, oldMessageId, message);
+}
+
 void TDLibReceiver::processUpdateActiveNotifications(const QVariantMap &receivedInformation)
 {
     qDebug() << "[TDLibReceiver] Received active notification groups";
@@ -277,6 +307,21 @@ void TDLibReceiver::processUpdateMessageContent(const QVariantMap &receivedInfor
     emit messageContentUpdated(chatId, messageId, receivedInformation.value("new_content").toMap());
 }
 
+void TDLibReceiver::processUpdateMessageEdited(const QVariantMap &receivedInformation)
+{
+    QString chatId = receivedInformation.value("chat_id").toString();
+    QString messageId = receivedInformation.value("message_id").toString();
+    qDebug() << "[TDLibReceiver] Message edited " << chatId << messageId;
+    emit messageEdited(chatId, messageId, receivedInformation.value("edit_date").toInt());
+}
+
+void TDLibReceiver::processUpdateMessageViews(const QVariantMap &receivedInformation)
+{
+    QString chatId = receivedInformation.value("chat_id").toString();
+    QString messageId = receivedInformation.value("message_id").toString();
+    emit messageViewsUpdated(chatId, messageId, receivedInformation.value("views").toInt());
+}
+
 void TDLibReceiver::processUpdateDeleteMessages(const QVariantMap &receivedInformation)
 {
     QString chatId = receivedInformation.value("chat_id").toString();
@@ -284,3 +329,33 @@ void TDLibReceiver::processUpdateDeleteMessages(const QVariantMap &receivedInfor
     qDebug() << "[TDLibReceiver] Some messages were deleted " << chatId;
     emit messagesDeleted(chatId, messageIds);
 }
+
+void TDLibReceiver::processUpdateChatTitle(const QVariantMap &receivedInformation)
+{
+    QString chatId = receivedInformation.value("chat_id").toString();
+    qDebug() << "[TDLibReceiver] Chat title updated " << chatId;
+    emit chatTitleUpdated(chatId, receivedInformation.value("title").toString());
+}
+
+void TDLibReceiver::processUpdateChatUnreadMentionCount(const QVariantMap &receivedInformation)
+{
+    QString chatId = receivedInformation.value("chat_id").toString();
+    qDebug() << "[TDLibReceiver] Unread mention count updated " << chatId << receivedInformation.value("unread_mention_count").toString();
+    emit chatUnreadMentionCountUpdated(chatId, receivedInformation.value("unread_mention_count").toInt());
+}
+
+void TDLibReceiver::processUpdateChatDraftMessage(const QVariantMap &receivedInformation)
+{
+    QString chatId = receivedInformation.value("chat_id").toString();
+    qDebug() << "[TDLibReceiver] Chat draft message updated " << chatId;
+    emit chatDraftMessageUpdated(chatId, receivedInformation.value("draft_message").toMap(), receivedInformation.value("order").toString());
+}
+
+void TDLibReceiver::processError(const QVariantMap &receivedInformation)
+{
+    QString extra = receivedInformation.value("@extra").toString();
+    qDebug() << "[TDLibReceiver] Received error " << receivedInformation.value("code").toString() << receivedInformation.value("message").toString() << extra;
+    if (extra.startsWith("sendMessage:")) {
+        emit sendMessageFailed(extra.mid(12), receivedInformation.value("message").toString());
+    }
+}
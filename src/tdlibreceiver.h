@@ -54,15 +54,24 @@ signals:
     void superGroupUpdated(const QString &groupId, const QVariantMap &groupInformation);
     void chatOnlineMemberCountUpdated(const QString &chatId, const int &onlineMemberCount);
     void messagesReceived(const QVariantList &messages);
+    void messagesFetched(const QString &requestTag, const QVariantList &messages);
     void newMessageReceived(const QString &chatId, const QVariantMap &message);
     void messageInformation(const QString &messageId, const QVariantMap &message);
+    void sentMessageReceived(const QString &requestTag, const QVariantMap &message);
+    void sendMessageFailed(const QString &requestTag, const QString &errorMessage);
     void messageSendSucceeded(const QString &messageId, const QString &oldMessageId, const QVariantMap &message);
+    void messageSendFailed(const QString &messageId, const QString &oldMessageId, const QVariantMap &message);
     void activeNotificationsUpdated(const QVariantList notificationGroups);
     void notificationGroupUpdated(const QVariantMap notificationGroupUpdate);
     void notificationUpdated(const QVariantMap updatedNotification);
     void chatNotificationSettingsUpdated(const QString &chatId, const QVariantMap updatedChatNotificationSettings);
     void messageContentUpdated(const QString &chatId, const QString &messageId, const QVariantMap &newContent);
+    void messageEdited(const QString &chatId, const QString &messageId, const int &editDate);
+    void messageViewsUpdated(const QString &chatId, const QString &messageId, const int &views);
     void messagesDeleted(const QString &chatId, const QVariantList &messageIds);
+    void chatTitleUpdated(const QString &chatId, const QString &title);
+    void chatUnreadMentionCountUpdated(const QString &chatId, const int &unreadMentionCount);
+    void chatDraftMessageUpdated(const QString &chatId, const QVariantMap &draftMessage, const QString &order);
 
 private:
     void *tdLibClient;
@@ -91,12 +100,19 @@ private:
     void processUpdateNewMessage(const QVariantMap &receivedInformation);
     void processMessage(const QVariantMap &receivedInformation);
     void processMessageSendSucceeded(const QVariantMap &receivedInformation);
+    void processMessageSendFailed(const QVariantMap &receivedInformation);
     void processUpdateActiveNotifications(const QVariantMap &receivedInformation);
     void processUpdateNotificationGroup(const QVariantMap &receivedInformation);
     void processUpdateNotification(const QVariantMap &receivedInformation);
     void processUpdateChatNotificationSettings(const QVariantMap &receivedInformation);
     void processUpdateMessageContent(const QVariantMap &receivedInformation);
+    void processUpdateMessageEdited(const QVariantMap &receivedInformation);
+    void processUpdateMessageViews(const QVariantMap &receivedInformation);
     void processUpdateDeleteMessages(const QVariantMap &receivedInformation);
+    void processUpdateChatTitle(const QVariantMap &receivedInformation);
+    void processUpdateChatUnreadMentionCount(const QVariantMap &receivedInformation);
+    void processUpdateChatDraftMessage(const QVariantMap &receivedInformation);
+    void processError(const QVariantMap &receivedInformation);
 };
 
 #endif // TDLIBRECEIVER_H
@@ -29,6 +29,15 @@
 #include <QStandardPaths>
 #include <QDBusConnection>
 #include <QDBusInterface>
+#include <QDateTime>
+
+namespace {
+
+    // Drafts are saved once typing pauses, typing is reported at most this often per chat
+    const int DRAFT_MESSAGE_DELAY = 2000;
+    const qint64 CHAT_ACTION_INTERVAL = 5000;
+
+}
 
 TDLibWrapper::TDLibWrapper(QObject *parent) : QObject(parent), settings("harbour-fernschreiber", "settings")
 {
@@ -45,6 +54,22 @@ TDLibWrapper::TDLibWrapper(QObject *parent) : QObject(parent), settings("harbour
     this->dbusInterface = new DBusInterface(this);
     this->initializeOpenWith();
 
+    this->connectionState = ConnectionState::WaitingForNetwork;
+    this->messageOutbox = new MessageOutbox(this);
+
+    // Decoding and encoding camera pictures takes far too long for the UI thread
+    this->mediaPreprocessor = new MediaPreprocessor();
+    this->mediaPreprocessor->moveToThread(&this->mediaThread);
+    connect(&this->mediaThread, SIGNAL(finished()), this->mediaPreprocessor, SLOT(deleteLater()));
+    connect(this, SIGNAL(photoPreparationRequested(QVariantMap)), this->mediaPreprocessor, SLOT(preparePhoto(QVariantMap)));
+    connect(this->mediaPreprocessor, SIGNAL(photoPrepared(QVariantMap)), this, SLOT(handlePhotoPrepared(QVariantMap)));
+    this->mediaThread.start();
+    QMetaObject::invokeMethod(this->mediaPreprocessor, "initializeUploadDirectory", Qt::QueuedConnection);
+
+    this->draftMessageTimer.setSingleShot(true);
+    this->draftMessageTimer.setInterval(DRAFT_MESSAGE_DELAY);
+    connect(&this->draftMessageTimer, SIGNAL(timeout()), this, SLOT(sendChatDraftMessages()));
+
     connect(this->tdLibReceiver, SIGNAL(versionDetected(QString)), this, SLOT(handleVersionDetected(QString)));
     connect(this->tdLibReceiver, SIGNAL(authorizationStateChanged(QString)), this, SLOT(handleAuthorizationStateChanged(QString)));
     connect(this->tdLibReceiver, SIGNAL(optionUpdated(QString, QVariant)), this, SLOT(handleOptionUpdated(QString, QVariant)));
@@ -65,13 +90,22 @@ TDLibWrapper::TDLibWrapper(QObject *parent) : QObject(parent), settings("harbour
     connect(this->tdLibReceiver, SIGNAL(messagesReceived(QVariantList)), this, SLOT(handleMessagesReceived(QVariantList)));
     connect(this->tdLibReceiver, SIGNAL(newMessageReceived(QString, QVariantMap)), this, SLOT(handleNewMessageReceived(QString, QVariantMap)));
     connect(this->tdLibReceiver, SIGNAL(messageInformation(QString, QVariantMap)), this, SLOT(handleMessageInformation(QString, QVariantMap)));
+    connect(this->tdLibReceiver, SIGNAL(messagesFetched(QString, QVariantList)), this, SLOT(handleMessagesFetched(QString, QVariantList)));
     connect(this->tdLibReceiver, SIGNAL(messageSendSucceeded(QString, QString, QVariantMap)), this, SLOT(handleMessageSendSucceeded(QString, QString, QVariantMap)));    
+    connect(this->tdLibReceiver, SIGNAL(sentMessageReceived(QString, QVariantMap)), this, SLOT(handleSentMessageReceived(QString, QVariantMap)));
+    connect(this->tdLibReceiver, SIGNAL(sendMessageFailed(QString, QString)), this, SLOT(handleSendMessageFailed(QString, QString)));
+    connect(this->tdLibReceiver, SIGNAL(messageSendFailed(QString, QString, QVariantMap)), this, SLOT(handleMessageSendFailed(QString, QString, QVariantMap)));
     connect(this->tdLibReceiver, SIGNAL(activeNotificationsUpdated(QVariantList)), this, SLOT(handleUpdateActiveNotifications(QVariantList)));
     connect(this->tdLibReceiver, SIGNAL(notificationGroupUpdated(QVariantMap)), this, SLOT(handleUpdateNotificationGroup(QVariantMap)));
     connect(this->tdLibReceiver, SIGNAL(notificationUpdated(QVariantMap)), this, SLOT(handleUpdateNotification(QVariantMap)));
     connect(this->tdLibReceiver, SIGNAL(chatNotificationSettingsUpdated(QString, QVariantMap)), this, SLOT(handleChatNotificationSettingsUpdated(QString, QVariantMap)));
     connect(this->tdLibReceiver, SIGNAL(messageContentUpdated(QString, QString, QVariantMap)), this, SLOT(handleMessageContentUpdated(QString, QString, QVariantMap)));
+    connect(this->tdLibReceiver, SIGNAL(messageEdited(QString, QString, int)), this, SLOT(handleMessageEdited(QString, QString, int)));
+    connect(this->tdLibReceiver, SIGNAL(messageViewsUpdated(QString, QString, int)), this, SLOT(handleMessageViewsUpdated(QString, QString, int)));
     connect(this->tdLibReceiver, SIGNAL(messagesDeleted(QString, QVariantList)), this, SLOT(handleMessagesDeleted(QString, QVariantList)));
+    connect(this->tdLibReceiver, SIGNAL(chatTitleUpdated(QString, QString)), this, SLOT(handleChatTitleUpdated(QString, QString)));
+    connect(this->tdLibReceiver, SIGNAL(chatUnreadMentionCountUpdated(QString, int)), this, SLOT(handleChatUnreadMentionCountUpdated(QString, int)));
+    connect(this->tdLibReceiver, SIGNAL(chatDraftMessageUpdated(QString, QVariantMap, QString)), this, SLOT(handleChatDraftMessageUpdated(QString, QVariantMap, QString)));
 
     this->tdLibReceiver->start();
 
@@ -82,6 +116,8 @@ TDLibWrapper::TDLibWrapper(QObject *parent) : QObject(parent), settings("harbour
 TDLibWrapper::~TDLibWrapper()
 {
     qDebug() << "[TDLibWrapper] Destroying TD Lib...";
+    this->mediaThread.quit();
+    this->mediaThread.wait();
     this->tdLibReceiver->setActive(false);
     while (this->tdLibReceiver->isRunning()) {
         QCoreApplication::processEvents(QEventLoop::AllEvents, 1000);
@@ -177,6 +213,9 @@ void TDLibWrapper::openChat(const QString &chatId)
 void TDLibWrapper::closeChat(const QString &chatId)
 {
     qDebug() << "[TDLibWrapper] Closing chat " << chatId;
+    if (this->pendingDraftMessages.contains(chatId)) {
+        this->sendChatDraftMessages();
+    }
     QVariantMap requestObject;
     requestObject.insert("@type", "closeChat");
     requestObject.insert("chat_id", chatId);
@@ -196,15 +235,13 @@ void TDLibWrapper::getChatHistory(const QString &chatId, const qlonglong &fromMe
     this->sendRequest(requestObject);
 }
 
-void TDLibWrapper::viewMessage(const QString &chatId, const QString &messageId)
+void TDLibWrapper::viewMessages(const QString &chatId, const QVariantList &messageIds)
 {
-    qDebug() << "[TDLibWrapper] Mark message as viewed " << chatId << messageId;
+    qDebug() << "[TDLibWrapper] Mark messages as viewed " << chatId << messageIds;
     QVariantMap requestObject;
     requestObject.insert("@type", "viewMessages");
     requestObject.insert("chat_id", chatId);
     requestObject.insert("force_read", false);
-    QVariantList messageIds;
-    messageIds.append(messageId);
     requestObject.insert("message_ids", messageIds);
     this->sendRequest(requestObject);
 }
@@ -212,20 +249,23 @@ void TDLibWrapper::viewMessage(const QString &chatId, const QString &messageId)
 void TDLibWrapper::sendTextMessage(const QString &chatId, const QString &message, const QString &replyToMessageId)
 {
     qDebug() << "[TDLibWrapper] Sending text message " << chatId << message << replyToMessageId;
-    QVariantMap requestObject;
-    requestObject.insert("@type", "sendMessage");
-    requestObject.insert("chat_id", chatId);
-    if (replyToMessageId != "0") {
-        requestObject.insert("reply_to_message_id", replyToMessageId);
+    // The message is shown right away, TDLib gets it as soon as there is a connection
+    QVariantMap localMessage = this->messageOutbox->addMessage(chatId, this->userInformation.value("id").toString(), message, replyToMessageId);
+    emit newMessageReceived(chatId, localMessage);
+    if (this->connectionState == ConnectionState::ConnectionReady) {
+        this->sendOutboxMessages();
     }
-    QVariantMap inputMessageContent;
-    inputMessageContent.insert("@type", "inputMessageText");
-    QVariantMap formattedText;
-    formattedText.insert("text", message);
-    formattedText.insert("@type", "formattedText");
-    inputMessageContent.insert("text", formattedText);
-    requestObject.insert("input_message_content", inputMessageContent);
-    this->sendRequest(requestObject);
+}
+
+void TDLibWrapper::sendPhotoMessage(const QString &chatId, const QString &filePath, const QString &message, const QString &replyToMessageId)
+{
+    qDebug() << "[TDLibWrapper] Preparing photo message " << chatId << filePath << replyToMessageId;
+    QVariantMap photoRequest;
+    photoRequest.insert("chat_id", chatId);
+    photoRequest.insert("file_path", filePath);
+    photoRequest.insert("message", message);
+    photoRequest.insert("reply_to_message_id", replyToMessageId);
+    emit photoPreparationRequested(photoRequest);
 }
 
 void TDLibWrapper::getMessage(const QString &chatId, const QString &messageId)
@@ -238,6 +278,23 @@ void TDLibWrapper::getMessage(const QString &chatId, const QString &messageId)
     this->sendRequest(requestObject);
 }
 
+void TDLibWrapper::getMessages(const QString &chatId, const QVariantList &messageIds)
+{
+    qDebug() << "[TDLibWrapper] Retrieving messages " << chatId << messageIds;
+    QStringList messageIdStrings;
+    QListIterator<QVariant> messageIdIterator(messageIds);
+    while (messageIdIterator.hasNext()) {
+        messageIdStrings.append(messageIdIterator.next().toString());
+    }
+    QVariantMap requestObject;
+    requestObject.insert("@type", "getMessages");
+    requestObject.insert("chat_id", chatId);
+    requestObject.insert("message_ids", messageIds);
+    // The answer is of the same type as the chat history, the tag tells it apart and names what was requested
+    requestObject.insert("@extra", "getMessages:" + chatId + ":" + messageIdStrings.join(","));
+    this->sendRequest(requestObject);
+}
+
 void TDLibWrapper::setOptionInteger(const QString &optionName, const int &optionValue)
 {
     qDebug() << "[TDLibWrapper] Setting integer option " << optionName << optionValue;
@@ -381,6 +438,21 @@ bool TDLibWrapper::getSendByEnter()
     return settings.value("sendByEnter", false).toBool();
 }
 
+void TDLibWrapper::setMessageWindowSize(const int &messageWindowSize)
+{
+    settings.setValue("messageWindowSize", messageWindowSize);
+}
+
+int TDLibWrapper::getMessageWindowSize()
+{
+    return settings.value("messageWindowSize", 500).toInt();
+}
+
+QVariantList TDLibWrapper::getOutboxMessages(const QString &chatId)
+{
+    return this->messageOutbox->getMessages(chatId);
+}
+
 DBusAdaptor *TDLibWrapper::getDBusAdaptor()
 {
     return this->dbusInterface->getDBusAdaptor();
@@ -472,6 +544,9 @@ void TDLibWrapper::handleConnectionStateChanged(const QString &connectionState)
     }
 
     emit connectionStateChanged(this->connectionState);
+    if (this->connectionState == ConnectionState::ConnectionReady) {
+        this->sendOutboxMessages();
+    }
 }
 
 void TDLibWrapper::handleUserUpdated(const QVariantMap &userInformation)
@@ -571,6 +646,12 @@ void TDLibWrapper::handleMessagesReceived(const QVariantList &messages)
 
 void TDLibWrapper::handleNewMessageReceived(const QString &chatId, const QVariantMap &message)
 {
+    // Messages from the outbox are already shown, until the answers to the send requests tell which is which they are held back
+    if (message.value("is_outgoing").toBool() && message.value("sending_state").toMap().value("@type").toString() == "messageSendingStatePending"
+            && this->messageOutbox->hasMessagesInFlight(chatId)) {
+        this->heldOutgoingMessages.insert(message.value("id").toString(), message);
+        return;
+    }
     emit newMessageReceived(chatId, message);
 }
 
@@ -579,11 +660,73 @@ void TDLibWrapper::handleMessageInformation(const QString &messageId, const QVar
     emit receivedMessage(messageId, message);
 }
 
+void TDLibWrapper::handleMessagesFetched(const QString &requestTag, const QVariantList &messages)
+{
+    QString chatId = requestTag.section(':', 0, 0);
+    QVariantList messageIds;
+    QStringList messageIdStrings = requestTag.section(':', 1).split(",", QString::SkipEmptyParts);
+    QListIterator<QString> messageIdIterator(messageIdStrings);
+    while (messageIdIterator.hasNext()) {
+        messageIds.append(messageIdIterator.next());
+    }
+    emit messagesFetched(chatId, messageIds, messages);
+}
+
 void TDLibWrapper::handleMessageSendSucceeded(const QString &messageId, const QString &oldMessageId, const QVariantMap &message)
 {
+    if (this->sentUploadFiles.contains(oldMessageId)) {
+        this->removeUploadFiles(this->sentUploadFiles.take(oldMessageId));
+    }
     emit messageSendSucceeded(messageId, oldMessageId, message);
 }
 
+void TDLibWrapper::handleMessageSendFailed(const QString &messageId, const QString &oldMessageId, const QVariantMap &message)
+{
+    if (this->sentUploadFiles.contains(oldMessageId)) {
+        this->removeUploadFiles(this->sentUploadFiles.take(oldMessageId));
+    }
+    emit messageSendFailed(messageId, oldMessageId, message);
+}
+
+void TDLibWrapper::handleSentMessageReceived(const QString &requestTag, const QVariantMap &message)
+{
+    // The message from the outbox just gets the ID assigned by TDLib
+    QString chatId = message.value("chat_id").toString();
+    QString messageId = message.value("id").toString();
+    if (this->requestedUploadFiles.contains(requestTag)) {
+        // Prepared files are needed until the upload is done, which is when TDLib reports the message as sent or failed
+        this->sentUploadFiles.insert(messageId, this->requestedUploadFiles.take(requestTag));
+        return;
+    }
+    this->heldOutgoingMessages.remove(messageId);
+    if (!this->messageOutbox->takeMessage(requestTag).isEmpty()) {
+        qDebug() << "[TDLibWrapper] Outbox message" << requestTag << "accepted by TDLib as" << messageId;
+        emit messageSendSucceeded(messageId, requestTag, message);
+    }
+    this->releaseHeldOutgoingMessages(chatId);
+}
+
+void TDLibWrapper::handleSendMessageFailed(const QString &requestTag, const QString &errorMessage)
+{
+    if (this->requestedUploadFiles.contains(requestTag)) {
+        qWarning() << "[TDLibWrapper] Photo message rejected by TDLib:" << errorMessage;
+        this->removeUploadFiles(this->requestedUploadFiles.take(requestTag));
+        return;
+    }
+    // Rejected messages are not tried again, they stay visible as failed until the chat is closed
+    QVariantMap message = this->messageOutbox->takeMessage(requestTag);
+    if (message.isEmpty()) {
+        return;
+    }
+    QString chatId = message.value("chat_id").toString();
+    qWarning() << "[TDLibWrapper] Outbox message" << requestTag << "rejected by TDLib:" << errorMessage;
+    QVariantMap sendingState;
+    sendingState.insert("@type", "messageSendingStateFailed");
+    message.insert("sending_state", sendingState);
+    emit messageSendFailed(requestTag, requestTag, message);
+    this->releaseHeldOutgoingMessages(chatId);
+}
+
 void TDLibWrapper::handleUpdateActiveNotifications(const QVariantList notificationGroups)
 {
     emit activeNotificationsUpdated(notificationGroups);
@@ -609,11 +752,187 @@ void TDLibWrapper::handleMessageContentUpdated(const QString &chatId, const QStr
     emit messageContentUpdated(chatId, messageId, newContent);
 }
 
+void TDLibWrapper::handleMessageEdited(const QString &chatId, const QString &messageId, const int &editDate)
+{
+    emit messageEdited(chatId, messageId, editDate);
+}
+
+void TDLibWrapper::handleMessageViewsUpdated(const QString &chatId, const QString &messageId, const int &views)
+{
+    emit messageViewsUpdated(chatId, messageId, views);
+}
+
 void TDLibWrapper::handleMessagesDeleted(const QString &chatId, const QVariantList &messageIds)
 {
     emit messagesDeleted(chatId, messageIds);
 }
 
+void TDLibWrapper::handleChatTitleUpdated(const QString &chatId, const QString &title)
+{
+    QVariantMap chatInformation = this->chats.value(chatId).toMap();
+    chatInformation.insert("title", title);
+    this->chats.insert(chatId, chatInformation);
+    emit chatTitleUpdated(chatId, title);
+}
+
+void TDLibWrapper::handleChatDraftMessageUpdated(const QString &chatId, const QVariantMap &draftMessage, const QString &order)
+{
+    QVariantMap chatInformation = this->chats.value(chatId).toMap();
+    chatInformation.insert("draft_message", draftMessage);
+    chatInformation.insert("order", order);
+    this->chats.insert(chatId, chatInformation);
+    emit chatDraftMessageUpdated(chatId, draftMessage);
+    // Chats with a draft are sorted like chats with a new message
+    emit chatOrderUpdated(chatId, order);
+}
+
+void TDLibWrapper::handleChatUnreadMentionCountUpdated(const QString &chatId, const int &unreadMentionCount)
+{
+    emit chatUnreadMentionCountUpdated(chatId, unreadMentionCount);
+}
+
+void TDLibWrapper::setChatDraftMessage(const QString &chatId, const QString &draft, const QString &replyToMessageId)
+{
+    // Restoring a draft into the text field reports the same text again, that doesn't need to be saved
+    QString knownDraft = this->chats.value(chatId).toMap().value("draft_message").toMap().value("input_message_text").toMap().value("text").toMap().value("text").toString();
+    if (!this->pendingDraftMessages.contains(chatId) && draft == knownDraft) {
+        return;
+    }
+    QVariantMap draftMessage;
+    draftMessage.insert("text", draft);
+    draftMessage.insert("reply_to_message_id", replyToMessageId);
+    this->pendingDraftMessages.insert(chatId, draftMessage);
+    // Only the state after the last change is saved
+    this->draftMessageTimer.start();
+}
+
+void TDLibWrapper::sendChatDraftMessages()
+{
+    this->draftMessageTimer.stop();
+    QHashIterator<QString, QVariantMap> draftMessageIterator(this->pendingDraftMessages);
+    while (draftMessageIterator.hasNext()) {
+        draftMessageIterator.next();
+        qDebug() << "[TDLibWrapper] Saving draft message " << draftMessageIterator.key();
+        QVariantMap requestObject;
+        requestObject.insert("@type", "setChatDraftMessage");
+        requestObject.insert("chat_id", draftMessageIterator.key());
+        QString draft = draftMessageIterator.value().value("text").toString();
+        if (!draft.isEmpty()) {
+            QVariantMap formattedText;
+            formattedText.insert("text", draft);
+            formattedText.insert("@type", "formattedText");
+            QVariantMap inputMessageText;
+            inputMessageText.insert("@type", "inputMessageText");
+            inputMessageText.insert("text", formattedText);
+            QVariantMap draftMessage;
+            draftMessage.insert("@type", "draftMessage");
+            draftMessage.insert("reply_to_message_id", draftMessageIterator.value().value("reply_to_message_id"));
+            draftMessage.insert("input_message_text", inputMessageText);
+            requestObject.insert("draft_message", draftMessage);
+        }
+        this->sendRequest(requestObject);
+    }
+    this->pendingDraftMessages.clear();
+}
+
+void TDLibWrapper::sendChatAction(const QString &chatId, const QString &action)
+{
+    // Telegram shows an action for about five seconds, reporting it more often isn't visible to anyone
+    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+    QString chatActionKey = chatId + ":" + action;
+    QHash<QString, qint64>::const_iterator lastChatAction = this->lastChatActions.constFind(chatActionKey);
+    if (lastChatAction != this->lastChatActions.constEnd() && currentTime - lastChatAction.value() < CHAT_ACTION_INTERVAL) {
+        return;
+    }
+    this->lastChatActions.insert(chatActionKey, currentTime);
+    qDebug() << "[TDLibWrapper] Sending chat action " << chatId << action;
+    QVariantMap requestObject;
+    requestObject.insert("@type", "sendChatAction");
+    requestObject.insert("chat_id", chatId);
+    QVariantMap chatAction;
+    chatAction.insert("@type", action);
+    requestObject.insert("action", chatAction);
+    this->sendRequest(requestObject);
+}
+
+void TDLibWrapper::handlePhotoPrepared(const QVariantMap &photoRequest)
+{
+    qDebug() << "[TDLibWrapper] Sending photo message " << photoRequest.value("chat_id").toString() << photoRequest.value("path").toString();
+    QVariantMap requestObject;
+    requestObject.insert("@type", "sendMessage");
+    requestObject.insert("chat_id", photoRequest.value("chat_id"));
+    if (photoRequest.value("reply_to_message_id").toString() != "0") {
+        requestObject.insert("reply_to_message_id", photoRequest.value("reply_to_message_id"));
+    }
+    QVariantMap inputMessageContent;
+    inputMessageContent.insert("@type", "inputMessagePhoto");
+    QVariantMap photoFile;
+    photoFile.insert("@type", "inputFileLocal");
+    photoFile.insert("path", photoRequest.value("path"));
+    inputMessageContent.insert("photo", photoFile);
+    if (photoRequest.contains("width")) {
+        inputMessageContent.insert("width", photoRequest.value("width"));
+        inputMessageContent.insert("height", photoRequest.value("height"));
+    }
+    if (photoRequest.contains("thumbnail_path")) {
+        QVariantMap thumbnailFile;
+        thumbnailFile.insert("@type", "inputFileLocal");
+        thumbnailFile.insert("path", photoRequest.value("thumbnail_path"));
+        QVariantMap thumbnail;
+        thumbnail.insert("@type", "inputThumbnail");
+        thumbnail.insert("thumbnail", thumbnailFile);
+        thumbnail.insert("width", photoRequest.value("thumbnail_width"));
+        thumbnail.insert("height", photoRequest.value("thumbnail_height"));
+        inputMessageContent.insert("thumbnail", thumbnail);
+    }
+    QVariantMap formattedText;
+    formattedText.insert("text", photoRequest.value("message"));
+    formattedText.insert("@type", "formattedText");
+    inputMessageContent.insert("caption", formattedText);
+    requestObject.insert("input_message_content", inputMessageContent);
+    QStringList uploadFiles = photoRequest.value("upload_files").toStringList();
+    if (!uploadFiles.isEmpty()) {
+        QString requestTag = uploadFiles.first();
+        this->requestedUploadFiles.insert(requestTag, uploadFiles);
+        requestObject.insert("@extra", "sendMessage:" + requestTag);
+    }
+    this->sendRequest(requestObject);
+}
+
+void TDLibWrapper::sendOutboxMessages()
+{
+    QListIterator<QVariant> requestIterator(this->messageOutbox->takeUnsentRequests());
+    while (requestIterator.hasNext()) {
+        this->sendRequest(requestIterator.next().toMap());
+    }
+}
+
+void TDLibWrapper::removeUploadFiles(const QStringList &uploadFiles)
+{
+    QListIterator<QString> uploadFileIterator(uploadFiles);
+    while (uploadFileIterator.hasNext()) {
+        QString uploadFile = uploadFileIterator.next();
+        qDebug() << "[TDLibWrapper] Removing upload file" << uploadFile;
+        QFile::remove(uploadFile);
+    }
+}
+
+void TDLibWrapper::releaseHeldOutgoingMessages(const QString &chatId)
+{
+    // Once all send requests of a chat are answered, what is left was sent from somewhere else
+    if (this->messageOutbox->hasMessagesInFlight(chatId)) {
+        return;
+    }
+    QMutableHashIterator<QString, QVariantMap> heldMessageIterator(this->heldOutgoingMessages);
+    while (heldMessageIterator.hasNext()) {
+        heldMessageIterator.next();
+        if (heldMessageIterator.value().value("chat_id").toString() == chatId) {
+            emit newMessageReceived(chatId, heldMessageIterator.value());
+            heldMessageIterator.remove();
+        }
+    }
+}
+
 void TDLibWrapper::setInitialParameters()
 {
     qDebug() << "[TDLibWrapper] Sending initial parameters to TD Lib";
@@ -20,15 +20,20 @@
 #define TDLIBWRAPPER_H
 
 #include <QCoreApplication>
+#include <QHash>
 #include <QObject>
 #include <QDebug>
 #include <QJsonDocument>
 #include <QStandardPaths>
 #include <QSettings>
+#include <QThread>
+#include <QTimer>
 #include <td/telegram/td_json_client.h>
 #include "tdlibreceiver.h"
 #include "dbusadaptor.h"
 #include "dbusinterface.h"
+#include "mediapreprocessor.h"
+#include "messageoutbox.h"
 
 class TDLibWrapper : public QObject
 {
@@ -76,6 +81,9 @@ public:
     Q_INVOKABLE void controlScreenSaver(const bool &enabled);
     Q_INVOKABLE void setSendByEnter(const bool &sendByEnter);
     Q_INVOKABLE bool getSendByEnter();
+    Q_INVOKABLE void setMessageWindowSize(const int &messageWindowSize);
+    Q_INVOKABLE int getMessageWindowSize();
+    Q_INVOKABLE QVariantList getOutboxMessages(const QString &chatId);
 
     DBusAdaptor *getDBusAdaptor();
 
@@ -89,13 +97,17 @@ public:
     Q_INVOKABLE void openChat(const QString &chatId);
     Q_INVOKABLE void closeChat(const QString &chatId);
     Q_INVOKABLE void getChatHistory(const QString &chatId, const qlonglong &fromMessageId = 0, const int &offset = 0, const int &limit = 50, const bool &onlyLocal = false);
-    Q_INVOKABLE void viewMessage(const QString &chatId, const QString &messageId);
+    Q_INVOKABLE void viewMessages(const QString &chatId, const QVariantList &messageIds);
     Q_INVOKABLE void sendTextMessage(const QString &chatId, const QString &message, const QString &replyToMessageId = "0");
+    Q_INVOKABLE void sendPhotoMessage(const QString &chatId, const QString &filePath, const QString &message, const QString &replyToMessageId = "0");
     Q_INVOKABLE void getMessage(const QString &chatId, const QString &messageId);
+    Q_INVOKABLE void getMessages(const QString &chatId, const QVariantList &messageIds);
     Q_INVOKABLE void setOptionInteger(const QString &optionName, const int &optionValue);
     Q_INVOKABLE void setChatNotificationSettings(const QString &chatId, const QVariantMap &notificationSettings);
     Q_INVOKABLE void editMessageText(const QString &chatId, const QString &messageId, const QString &message);
     Q_INVOKABLE void deleteMessages(const QString &chatId, const QVariantList messageIds);
+    Q_INVOKABLE void setChatDraftMessage(const QString &chatId, const QString &draft, const QString &replyToMessageId = "0");
+    Q_INVOKABLE void sendChatAction(const QString &chatId, const QString &action = "chatActionTyping");
 
 signals:
     void versionDetected(const QString &version);
@@ -116,17 +128,25 @@ signals:
     void superGroupUpdated(const QString &groupId, const QVariantMap &groupInformation);
     void chatOnlineMemberCountUpdated(const QString &chatId, const int &onlineMemberCount);
     void messagesReceived(const QVariantList &messages);
+    void messagesFetched(const QString &chatId, const QVariantList &messageIds, const QVariantList &messages);
     void newMessageReceived(const QString &chatId, const QVariantMap &message);
     void copyToDownloadsSuccessful(const QString &fileName, const QString &filePath);
     void copyToDownloadsError(const QString &fileName, const QString &filePath);
     void receivedMessage(const QString &messageId, const QVariantMap &message);
     void messageSendSucceeded(const QString &messageId, const QString &oldMessageId, const QVariantMap &message);
+    void messageSendFailed(const QString &messageId, const QString &oldMessageId, const QVariantMap &message);
     void activeNotificationsUpdated(const QVariantList notificationGroups);
     void notificationGroupUpdated(const QVariantMap notificationGroupUpdate);
     void notificationUpdated(const QVariantMap updatedNotification);
     void chatNotificationSettingsUpdated(const QString &chatId, const QVariantMap chatNotificationSettings);
     void messageContentUpdated(const QString &chatId, const QString &messageId, const QVariantMap &newContent);
+    void messageEdited(const QString &chatId, const QString &messageId, const int &editDate);
+    void messageViewsUpdated(const QString &chatId, const QString &messageId, const int &views);
     void messagesDeleted(const QString &chatId, const QVariantList &messageIds);
+    void chatTitleUpdated(const QString &chatId, const QString &title);
+    void chatUnreadMentionCountUpdated(const QString &chatId, const int &unreadMentionCount);
+    void photoPreparationRequested(const QVariantMap &photoRequest);
+    void chatDraftMessageUpdated(const QString &chatId, const QVariantMap &draftMessage);
 
 public slots:
     void handleVersionDetected(const QString &version);
@@ -149,18 +169,40 @@ public slots:
     void handleMessagesReceived(const QVariantList &messages);
     void handleNewMessageReceived(const QString &chatId, const QVariantMap &message);
     void handleMessageInformation(const QString &messageId, const QVariantMap &message);
+    void handleMessagesFetched(const QString &requestTag, const QVariantList &messages);
     void handleMessageSendSucceeded(const QString &messageId, const QString &oldMessageId, const QVariantMap &message);
+    void handleSentMessageReceived(const QString &requestTag, const QVariantMap &message);
+    void handleMessageSendFailed(const QString &messageId, const QString &oldMessageId, const QVariantMap &message);
+    void handleSendMessageFailed(const QString &requestTag, const QString &errorMessage);
     void handleUpdateActiveNotifications(const QVariantList notificationGroups);
     void handleUpdateNotificationGroup(const QVariantMap notificationGroupUpdate);
     void handleUpdateNotification(const QVariantMap updatedNotification);
     void handleChatNotificationSettingsUpdated(const QString &chatId, const QVariantMap &chatNotificationSettings);
     void handleMessageContentUpdated(const QString &chatId, const QString &messageId, const QVariantMap &newContent);
+    void handleMessageEdited(const QString &chatId, const QString &messageId, const int &editDate);
+    void handleMessageViewsUpdated(const QString &chatId, const QString &messageId, const int &views);
     void handleMessagesDeleted(const QString &chatId, const QVariantList &messageIds);
+    void handleChatTitleUpdated(const QString &chatId, const QString &title);
+    void handleChatUnreadMentionCountUpdated(const QString &chatId, const int &unreadMentionCount);
+    void handlePhotoPrepared(const QVariantMap &photoRequest);
+    void handleChatDraftMessageUpdated(const QString &chatId, const QVariantMap &draftMessage, const QString &order);
+
+private slots:
+    void sendChatDraftMessages();
 
 private:
     void *tdLibClient;
     TDLibReceiver *tdLibReceiver;
     DBusInterface *dbusInterface;
+    MessageOutbox *messageOutbox;
+    QHash<QString, QVariantMap> heldOutgoingMessages;
+    QHash<QString, QStringList> requestedUploadFiles;
+    QHash<QString, QStringList> sentUploadFiles;
+    QThread mediaThread;
+    MediaPreprocessor *mediaPreprocessor;
+    QHash<QString, QVariantMap> pendingDraftMessages;
+    QTimer draftMessageTimer;
+    QHash<QString, qint64> lastChatActions;
     QString version;
     TDLibWrapper::AuthorizationState authorizationState;
     TDLibWrapper::ConnectionState connectionState;
@@ -178,6 +220,9 @@ private:
     void setEncryptionKey();
     void setLogVerbosityLevel();
     void initializeOpenWith();
+    void sendOutboxMessages();
+    void releaseHeldOutgoingMessages(const QString &chatId);
+    void removeUploadFiles(const QStringList &uploadFiles);
 
 };
 
@@ -0,0 +1,202 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "unreadaggregator.h"
+#include <QDebug>
+
+UnreadAggregator::UnreadAggregator(TDLibWrapper *tdLibWrapper, QObject *parent) : QObject(parent)
+{
+    this->tdLibWrapper = tdLibWrapper;
+    connect(this->tdLibWrapper, SIGNAL(newChatDiscovered(QString, QVariantMap)), this, SLOT(handleChatDiscovered(QString, QVariantMap)));
+    connect(this->tdLibWrapper, SIGNAL(chatLastMessageUpdated(QString, QString, QVariantMap)), this, SLOT(handleChatLastMessageUpdated(QString, QString, QVariantMap)));
+    connect(this->tdLibWrapper, SIGNAL(chatOrderUpdated(QString, QString)), this, SLOT(handleChatOrderUpdated(QString, QString)));
+    connect(this->tdLibWrapper, SIGNAL(chatReadInboxUpdated(QString, QString, int)), this, SLOT(handleChatReadInboxUpdated(QString, QString, int)));
+    connect(this->tdLibWrapper, SIGNAL(chatNotificationSettingsUpdated(QString, QVariantMap)), this, SLOT(handleChatNotificationSettingsUpdated(QString, QVariantMap)));
+    connect(this->tdLibWrapper, SIGNAL(chatUnreadMentionCountUpdated(QString, int)), this, SLOT(handleChatUnreadMentionCountUpdated(QString, int)));
+}
+
+UnreadAggregator::~UnreadAggregator()
+{
+    qDebug() << "[UnreadAggregator] Destroying myself...";
+}
+
+int UnreadAggregator::getUnreadMessageCount() const
+{
+    return this->publishedTotals.unreadMessageCount;
+}
+
+int UnreadAggregator::getUnreadUnmutedMessageCount() const
+{
+    return this->publishedTotals.unreadUnmutedMessageCount;
+}
+
+int UnreadAggregator::getUnreadChatCount() const
+{
+    return this->publishedTotals.unreadChatCount;
+}
+
+int UnreadAggregator::getUnreadUnmutedChatCount() const
+{
+    return this->publishedTotals.unreadUnmutedChatCount;
+}
+
+int UnreadAggregator::getUnreadMentionCount() const
+{
+    return this->publishedTotals.unreadMentionCount;
+}
+
+int UnreadAggregator::getUnreadPrivateChatCount() const
+{
+    return this->publishedTotals.unreadCategoryChatCount[PrivateChat];
+}
+
+int UnreadAggregator::getUnreadGroupChatCount() const
+{
+    return this->publishedTotals.unreadCategoryChatCount[GroupChat];
+}
+
+int UnreadAggregator::getUnreadChannelChatCount() const
+{
+    return this->publishedTotals.unreadCategoryChatCount[ChannelChat];
+}
+
+void UnreadAggregator::handleChatDiscovered(const QString &chatId, const QVariantMap &chatInformation)
+{
+    ChatUnreadState chatState;
+    chatState.unreadCount = chatInformation.value("unread_count").toInt();
+    chatState.unreadMentionCount = chatInformation.value("unread_mention_count").toInt();
+    chatState.muted = chatInformation.value("notification_settings").toMap().value("mute_for").toInt() > 0;
+    chatState.listed = chatInformation.value("order").toLongLong() != 0;
+    QVariantMap chatType = chatInformation.value("type").toMap();
+    QString chatTypeName = chatType.value("@type").toString();
+    if (chatTypeName == "chatTypeBasicGroup") {
+        chatState.category = GroupChat;
+    } else if (chatTypeName == "chatTypeSupergroup") {
+        chatState.category = chatType.value("is_channel").toBool() ? ChannelChat : GroupChat;
+    } else {
+        chatState.category = PrivateChat;
+    }
+    this->replaceChatState(chatId, chatState);
+}
+
+void UnreadAggregator::handleChatLastMessageUpdated(const QString &chatId, const QString &order, const QVariantMap &lastMessage)
+{
+    Q_UNUSED(lastMessage)
+    this->handleChatOrderUpdated(chatId, order);
+}
+
+void UnreadAggregator::handleChatOrderUpdated(const QString &chatId, const QString &order)
+{
+    if (!this->chatStates.contains(chatId)) {
+        return;
+    }
+    // Chats with order 0 are not part of the main chat list and therefore don't count
+    ChatUnreadState chatState = this->chatStates.value(chatId);
+    chatState.listed = order.toLongLong() != 0;
+    this->replaceChatState(chatId, chatState);
+}
+
+void UnreadAggregator::handleChatReadInboxUpdated(const QString &chatId, const QString &lastReadInboxMessageId, const int &unreadCount)
+{
+    Q_UNUSED(lastReadInboxMessageId)
+    if (!this->chatStates.contains(chatId)) {
+        return;
+    }
+    // TDLib reports incoming messages by this update as well, so new messages are counted here
+    ChatUnreadState chatState = this->chatStates.value(chatId);
+    chatState.unreadCount = unreadCount;
+    this->replaceChatState(chatId, chatState);
+}
+
+void UnreadAggregator::handleChatNotificationSettingsUpdated(const QString &chatId, const QVariantMap &chatNotificationSettings)
+{
+    if (!this->chatStates.contains(chatId)) {
+        return;
+    }
+    ChatUnreadState chatState = this->chatStates.value(chatId);
+    chatState.muted = chatNotificationSettings.value("mute_for").toInt() > 0;
+    this->replaceChatState(chatId, chatState);
+}
+
+void UnreadAggregator::handleChatUnreadMentionCountUpdated(const QString &chatId, const int &unreadMentionCount)
+{
+    if (!this->chatStates.contains(chatId)) {
+        return;
+    }
+    ChatUnreadState chatState = this->chatStates.value(chatId);
+    chatState.unreadMentionCount = unreadMentionCount;
+    this->replaceChatState(chatId, chatState);
+}
+
+void UnreadAggregator::applyChatState(const ChatUnreadState &chatState, const int &sign)
+{
+    if (!chatState.listed || chatState.unreadCount <= 0) {
+        return;
+    }
+    this->totals.unreadMessageCount += sign * chatState.unreadCount;
+    this->totals.unreadChatCount += sign;
+    this->totals.unreadMentionCount += sign * chatState.unreadMentionCount;
+    this->totals.unreadCategoryChatCount[chatState.category] += sign;
+    if (!chatState.muted) {
+        this->totals.unreadUnmutedMessageCount += sign * chatState.unreadCount;
+        this->totals.unreadUnmutedChatCount += sign;
+    }
+}
+
+void UnreadAggregator::replaceChatState(const QString &chatId, const ChatUnreadState &updatedChatState)
+{
+    QHash<QString, ChatUnreadState>::const_iterator previousChatState = this->chatStates.constFind(chatId);
+    if (previousChatState != this->chatStates.constEnd()) {
+        this->applyChatState(previousChatState.value(), -1);
+    }
+    this->applyChatState(updatedChatState, 1);
+    this->chatStates.insert(chatId, updatedChatState);
+    this->publishTotals();
+}
+
+void UnreadAggregator::publishTotals()
+{
+    // Only totals which really changed are announced, so bound UI elements aren't re-evaluated needlessly
+    UnreadTotals previousTotals = this->publishedTotals;
+    this->publishedTotals = this->totals;
+    if (previousTotals.unreadMessageCount != this->totals.unreadMessageCount) {
+        emit unreadMessageCountChanged();
+    }
+    if (previousTotals.unreadUnmutedMessageCount != this->totals.unreadUnmutedMessageCount) {
+        emit unreadUnmutedMessageCountChanged();
+    }
+    if (previousTotals.unreadChatCount != this->totals.unreadChatCount) {
+        emit unreadChatCountChanged();
+    }
+    if (previousTotals.unreadUnmutedChatCount != this->totals.unreadUnmutedChatCount) {
+        emit unreadUnmutedChatCountChanged();
+    }
+    if (previousTotals.unreadMentionCount != this->totals.unreadMentionCount) {
+        emit unreadMentionCountChanged();
+    }
+    if (previousTotals.unreadCategoryChatCount[PrivateChat] != this->totals.unreadCategoryChatCount[PrivateChat]) {
+        emit unreadPrivateChatCountChanged();
+    }
+    if (previousTotals.unreadCategoryChatCount[GroupChat] != this->totals.unreadCategoryChatCount[GroupChat]) {
+        emit unreadGroupChatCountChanged();
+    }
+    if (previousTotals.unreadCategoryChatCount[ChannelChat] != this->totals.unreadCategoryChatCount[ChannelChat]) {
+        emit unreadChannelChatCountChanged();
+    }
+}
@@ -0,0 +1,103 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UNREADAGGREGATOR_H
+#define UNREADAGGREGATOR_H
+
+#include <QObject>
+#include <QHash>
+#include "tdlibwrapper.h"
+
+class UnreadAggregator : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int unreadMessageCount READ getUnreadMessageCount NOTIFY unreadMessageCountChanged)
+    Q_PROPERTY(int unreadUnmutedMessageCount READ getUnreadUnmutedMessageCount NOTIFY unreadUnmutedMessageCountChanged)
+    Q_PROPERTY(int unreadChatCount READ getUnreadChatCount NOTIFY unreadChatCountChanged)
+    Q_PROPERTY(int unreadUnmutedChatCount READ getUnreadUnmutedChatCount NOTIFY unreadUnmutedChatCountChanged)
+    Q_PROPERTY(int unreadMentionCount READ getUnreadMentionCount NOTIFY unreadMentionCountChanged)
+    Q_PROPERTY(int unreadPrivateChatCount READ getUnreadPrivateChatCount NOTIFY unreadPrivateChatCountChanged)
+    Q_PROPERTY(int unreadGroupChatCount READ getUnreadGroupChatCount NOTIFY unreadGroupChatCountChanged)
+    Q_PROPERTY(int unreadChannelChatCount READ getUnreadChannelChatCount NOTIFY unreadChannelChatCountChanged)
+public:
+    explicit UnreadAggregator(TDLibWrapper *tdLibWrapper, QObject *parent = nullptr);
+    ~UnreadAggregator() override;
+
+    int getUnreadMessageCount() const;
+    int getUnreadUnmutedMessageCount() const;
+    int getUnreadChatCount() const;
+    int getUnreadUnmutedChatCount() const;
+    int getUnreadMentionCount() const;
+    int getUnreadPrivateChatCount() const;
+    int getUnreadGroupChatCount() const;
+    int getUnreadChannelChatCount() const;
+
+signals:
+    void unreadMessageCountChanged();
+    void unreadUnmutedMessageCountChanged();
+    void unreadChatCountChanged();
+    void unreadUnmutedChatCountChanged();
+    void unreadMentionCountChanged();
+    void unreadPrivateChatCountChanged();
+    void unreadGroupChatCountChanged();
+    void unreadChannelChatCountChanged();
+
+public slots:
+    void handleChatDiscovered(const QString &chatId, const QVariantMap &chatInformation);
+    void handleChatLastMessageUpdated(const QString &chatId, const QString &order, const QVariantMap &lastMessage);
+    void handleChatOrderUpdated(const QString &chatId, const QString &order);
+    void handleChatReadInboxUpdated(const QString &chatId, const QString &lastReadInboxMessageId, const int &unreadCount);
+    void handleChatNotificationSettingsUpdated(const QString &chatId, const QVariantMap &chatNotificationSettings);
+    void handleChatUnreadMentionCountUpdated(const QString &chatId, const int &unreadMentionCount);
+
+private:
+    enum ChatCategory {
+        PrivateChat,
+        GroupChat,
+        ChannelChat
+    };
+
+    struct ChatUnreadState {
+        int unreadCount = 0;
+        int unreadMentionCount = 0;
+        bool muted = false;
+        bool listed = false;
+        ChatCategory category = PrivateChat;
+    };
+
+    struct UnreadTotals {
+        int unreadMessageCount = 0;
+        int unreadUnmutedMessageCount = 0;
+        int unreadChatCount = 0;
+        int unreadUnmutedChatCount = 0;
+        int unreadMentionCount = 0;
+        int unreadCategoryChatCount[3] = { 0, 0, 0 };
+    };
+
+    TDLibWrapper *tdLibWrapper;
+    QHash<QString, ChatUnreadState> chatStates;
+    UnreadTotals totals;
+    UnreadTotals publishedTotals;
+
+    void applyChatState(const ChatUnreadState &chatState, const int &sign);
+    void replaceChatState(const QString &chatId, const ChatUnreadState &updatedChatState);
+    void publishTotals();
+};
+
+#endif // UNREADAGGREGATOR_H
@@ -0,0 +1,39 @@
+TARGET = tst_chatmodel
+
+CONFIG += testcase link_pkgconfig
+
+PKGCONFIG += sailfishapp
+
+QT += core dbus quick testlib
+
+APP_SOURCES = $$PWD/../../src
+
+SOURCES += tst_chatmodel.cpp \
+    $$APP_SOURCES/chatmodel.cpp \
+    $$APP_SOURCES/dbusadaptor.cpp \
+    $$APP_SOURCES/dbusinterface.cpp \
+    $$APP_SOURCES/emojiengine.cpp \
+    $$APP_SOURCES/mediapreprocessor.cpp \
+    $$APP_SOURCES/messageformatter.cpp \
+    $$APP_SOURCES/messageoutbox.cpp \
+    $$APP_SOURCES/relativetimeclock.cpp \
+    $$APP_SOURCES/tdlibreceiver.cpp \
+    $$APP_SOURCES/tdlibwrapper.cpp
+
+HEADERS += \
+    $$APP_SOURCES/chatmodel.h \
+    $$APP_SOURCES/dbusadaptor.h \
+    $$APP_SOURCES/dbusinterface.h \
+    $$APP_SOURCES/emojiengine.h \
+    $$APP_SOURCES/mediapreprocessor.h \
+    $$APP_SOURCES/messageformatter.h \
+    $$APP_SOURCES/messageoutbox.h \
+    $$APP_SOURCES/relativetimeclock.h \
+    $$APP_SOURCES/tdlibreceiver.h \
+    $$APP_SOURCES/tdlibsecrets.h \
+    $$APP_SOURCES/tdlibwrapper.h
+
+LIBS += -L$$PWD/../../tdlib/lib/ -ltdjson
+
+INCLUDEPATH += $$APP_SOURCES $$PWD/../../tdlib/include
+DEPENDPATH += $$APP_SOURCES $$PWD/../../tdlib/include
@@ -0,0 +1,136 @@
+/*
+    Copyright (C) 2020 Sebastian J. Wolf
+
+    This file is part of Fernschreiber.
+
+    Fernschreiber is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Fernschreiber is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Fernschreiber. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include "chatmodel.h"
+
+namespace {
+
+    const int MESSAGE_COUNT = 5000;
+    const int DELETED_MESSAGE_COUNT = 500;
+
+    qint64 getMessageId(const int &index)
+    {
+        return Q_INT64_C(1048576) * (index + 1);
+    }
+
+}
+
+class TestChatModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void benchmarkDeleteMessages_data();
+    void benchmarkDeleteMessages();
+
+private:
+    QString chatId;
+    int chatCount;
+    TDLibWrapper *tdLibWrapper;
+    RelativeTimeClock *relativeTimeClock;
+    EmojiEngine *emojiEngine;
+    ChatModel *chatModel;
+};
+
+void TestChatModel::initTestCase()
+{
+    // Keeps the TDLib database and the settings away from the ones of the installed app
+    QStandardPaths::setTestModeEnabled(true);
+    this->chatCount = 0;
+    this->tdLibWrapper = new TDLibWrapper();
+    this->tdLibWrapper->setMessageWindowSize(MESSAGE_COUNT);
+    this->relativeTimeClock = new RelativeTimeClock();
+    this->emojiEngine = new EmojiEngine();
+    this->chatModel = new ChatModel(this->tdLibWrapper, this->relativeTimeClock, this->emojiEngine);
+}
+
+void TestChatModel::cleanupTestCase()
+{
+    delete this->chatModel;
+    delete this->emojiEngine;
+    delete this->relativeTimeClock;
+    delete this->tdLibWrapper;
+}
+
+void TestChatModel::init()
+{
+    // Every run gets a chat of its own, the previous one must not be restored from the chat state cache
+    this->chatId = QString::number(++this->chatCount);
+    QVariantMap chatInformation;
+    chatInformation.insert("id", this->chatId);
+    this->chatModel->initialize(chatInformation);
+
+    QVariantList messages;
+    for (int i = 0; i < MESSAGE_COUNT; i++) {
+        QVariantMap formattedText;
+        formattedText.insert("@type", "formattedText");
+        formattedText.insert("text", "Message " + QString::number(i));
+        QVariantMap content;
+        content.insert("@type", "messageText");
+        content.insert("text", formattedText);
+        QVariantMap message;
+        message.insert("@type", "message");
+        message.insert("id", getMessageId(i));
+        message.insert("chat_id", this->chatId);
+        message.insert("sender_user_id", QString::number(i % 7 + 1));
+        message.insert("date", 1600000000 + i * 60);
+        message.insert("content", content);
+        messages.append(message);
+    }
+    this->chatModel->handleMessagesReceived(messages);
+    QCOMPARE(this->chatModel->rowCount(QModelIndex()), MESSAGE_COUNT);
+}
+
+void TestChatModel::benchmarkDeleteMessages_data()
+{
+    QTest::addColumn<QVariantList>("deletedMessageIds");
+
+    // Every tenth message, each one is a row range of its own
+    QVariantList scatteredMessageIds;
+    for (int i = 0; i < MESSAGE_COUNT; i += MESSAGE_COUNT / DELETED_MESSAGE_COUNT) {
+        scatteredMessageIds.append(QString::number(getMessageId(i)));
+    }
+    QTest::newRow("scattered") << scatteredMessageIds;
+
+    // A block in the middle of the model, like a purged conversation, removed as a single row range
+    QVariantList contiguousMessageIds;
+    int firstDeletedIndex = (MESSAGE_COUNT - DELETED_MESSAGE_COUNT) / 2;
+    for (int i = firstDeletedIndex; i < firstDeletedIndex + DELETED_MESSAGE_COUNT; i++) {
+        contiguousMessageIds.append(QString::number(getMessageId(i)));
+    }
+    QTest::newRow("contiguous") << contiguousMessageIds;
+}
+
+void TestChatModel::benchmarkDeleteMessages()
+{
+    QFETCH(QVariantList, deletedMessageIds);
+    // The model has to be filled again before every run, so the deletion is measured once per test run
+    QBENCHMARK_ONCE {
+        this->chatModel->handleMessagesDeleted(this->chatId, deletedMessageIds);
+    }
+    QCOMPARE(this->chatModel->rowCount(QModelIndex()), MESSAGE_COUNT - deletedMessageIds.size());
+}
+
+QTEST_MAIN(TestChatModel)
+
+#include "tst_chatmodel.moc"
@@ -0,0 +1,12 @@
+# Unit tests and benchmarks, built separately from the application:
+#   qmake tests/tests.pro && make && make check
+#
+# ChatModel can't be used without a TDLibWrapper, so tst_chatmodel links against
+# tdjson and starts a real TDLib client with its receiver thread. Nothing is sent
+# to Telegram, as the client is never authorized. QStandardPaths test mode puts the
+# TDLib database and the settings (messageWindowSize is written by the benchmark)
+# below ~/.qttest instead of the directories of the installed app.
+
+TEMPLATE = subdirs
+
+SUBDIRS += chatmodel
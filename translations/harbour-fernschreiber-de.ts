@@ -87,6 +87,28 @@
         <translation>%1</translation>
     </message>
 </context>
+<context>
+    <name>ChatListModel</name>
+    <message>
+        <source>Unknown</source>
+        <translation>Unbekannt</translation>
+    </message>
+    <message>
+        <source>You</source>
+        <translation>Sie</translation>
+    </message>
+</context>
+<context>
+    <name>ChatModel</name>
+    <message>
+        <source>You</source>
+        <translation>Sie</translation>
+    </message>
+    <message>
+        <source>Message not available</source>
+        <translation>Nachricht nicht verfügbar</translation>
+    </message>
+</context>
 <context>
     <name>ChatPage</name>
     <message>
@@ -297,6 +319,110 @@
         <translation>Bitte geben Sie Ihr Passwort ein:</translation>
     </message>
 </context>
+<context>
+    <name>MessageFormatter</name>
+    <message>
+        <source>Sticker: %1</source>
+        <translation>Sticker: %1</translation>
+    </message>
+    <message>
+        <source>sent a picture</source>
+        <translation>hat ein Bild geschickt</translation>
+    </message>
+    <message>
+        <source>Picture: %1</source>
+        <translation>Bild: %1</translation>
+    </message>
+    <message>
+        <source>sent a video</source>
+        <translation>hat ein Video geschickt</translation>
+    </message>
+    <message>
+        <source>Video: %1</source>
+        <translation>Video: %1</translation>
+    </message>
+    <message>
+        <source>sent an animation</source>
+        <translation>hat eine Animation geschickt</translation>
+    </message>
+    <message>
+        <source>Animation: %1</source>
+        <translation>Animation: %1</translation>
+    </message>
+    <message>
+        <source>sent an audio</source>
+        <translation>hat eine Audiodatei geschickt</translation>
+    </message>
+    <message>
+        <source>Audio: %1</source>
+        <translation>Audio: %1</translation>
+    </message>
+    <message>
+        <source>sent a voice note</source>
+        <translation>hat eine Sprachnachricht geschickt</translation>
+    </message>
+    <message>
+        <source>Voice Note: %1</source>
+        <translation>Sprachnachricht: %1</translation>
+    </message>
+    <message>
+        <source>sent a document</source>
+        <translation>hat ein Dokument geschickt</translation>
+    </message>
+    <message>
+        <source>Document: %1</source>
+        <translation>Dokument: %1</translation>
+    </message>
+    <message>
+        <source>sent a location</source>
+        <translation>hat einen Ort geschickt</translation>
+    </message>
+    <message>
+        <source>has registered with Telegram</source>
+        <translation>hat sich bei Telegram angemeldet</translation>
+    </message>
+    <message>
+        <source>joined this chat</source>
+        <translation>ist diesem Chat beigetreten</translation>
+    </message>
+    <message>
+        <source>was added to this chat</source>
+        <translation>wurde diesem Chat hinzugefügt</translation>
+    </message>
+    <message>
+        <source>left this chat</source>
+        <translation>hat diesen Chat verlassen</translation>
+    </message>
+    <message>
+        <source>Unsupported message: %1</source>
+        <translation>Nicht unterstützte Nachricht: %1</translation>
+    </message>
+    <message>
+        <source>now</source>
+        <translation>jetzt</translation>
+    </message>
+    <message numerus="yes">
+        <source>%n minute(s) ago</source>
+        <translation>
+            <numerusform>vor %n Minute</numerusform>
+            <numerusform>vor %n Minuten</numerusform>
+        </translation>
+    </message>
+    <message numerus="yes">
+        <source>%n hour(s) ago</source>
+        <translation>
+            <numerusform>vor %n Stunde</numerusform>
+            <numerusform>vor %n Stunden</numerusform>
+        </translation>
+    </message>
+    <message numerus="yes">
+        <source>%n day(s) ago</source>
+        <translation>
+            <numerusform>vor %n Tag</numerusform>
+            <numerusform>vor %n Tagen</numerusform>
+        </translation>
+    </message>
+</context>
 <context>
     <name>NotificationManager</name>
     <message>
@@ -398,6 +524,38 @@
         <source>Settings</source>
         <translation>Einstellungen</translation>
     </message>
+    <message>
+        <source>Search chats</source>
+        <translation>Chats durchsuchen</translation>
+    </message>
+    <message>
+        <source>Show</source>
+        <translation>Anzeigen</translation>
+    </message>
+    <message>
+        <source>All chats</source>
+        <translation>Alle Chats</translation>
+    </message>
+    <message>
+        <source>Unread chats</source>
+        <translation>Ungelesene Chats</translation>
+    </message>
+    <message>
+        <source>Muted chats</source>
+        <translation>Stummgeschaltete Chats</translation>
+    </message>
+    <message>
+        <source>Groups</source>
+        <translation>Gruppen</translation>
+    </message>
+    <message>
+        <source>Channels</source>
+        <translation>Kanäle</translation>
+    </message>
+    <message>
+        <source>Private chats</source>
+        <translation>Private Chats</translation>
+    </message>
 </context>
 <context>
     <name>SettingsPage</name>
@@ -417,6 +575,14 @@
         <source>Send your message by pressing the enter key</source>
         <translation>Senden Sie Ihre Nachricht, indem Sie die Enter-Taste drücken</translation>
     </message>
+    <message>
+        <source>Messages kept in memory</source>
+        <translation>Nachrichten im Speicher</translation>
+    </message>
+    <message>
+        <source>Older messages are loaded again from the local database when you scroll back to them</source>
+        <translation>Ältere Nachrichten werden erneut aus der lokalen Datenbank geladen, wenn Sie zu ihnen zurückscrollen</translation>
+    </message>
 </context>
 <context>
     <name>VideoPage</name>